@@ -0,0 +1,375 @@
+#include "include/asset_bundle.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <vector>
+
+struct AssetBundle::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+  uint32_t slots;
+  uint32_t reserved;
+  uint64_t slotsOffset;
+  uint64_t entriesOffset;
+  uint64_t stringsOffset;
+  uint64_t stringsSize;
+  uint64_t size;
+  // CRC-32 of the bytes after the header
+  uint64_t checksum;
+};
+
+struct AssetBundle::Entry {
+  uint64_t hash;
+  // offsets into the strings
+  uint32_t path;
+  uint32_t pathLength;
+  uint32_t etag;
+  uint32_t gzipEtag;
+  uint32_t type;
+  uint32_t reserved;
+  // offsets into the file, gzipSize is 0 if there is no gzip variant
+  uint64_t body;
+  uint64_t bodySize;
+  uint64_t gzip;
+  uint64_t gzipSize;
+};
+
+namespace {
+const char MAGIC[8] = {'G', '1', 'B', 'U', 'N', 'D', 'L', 'E'};
+const uint32_t VERSION = 1;
+
+// Bodies are laid out on pages of this size.
+const uint64_t BUNDLE_PAGE_SIZE = 4096;
+
+// A body smaller than a page starts on this alignment.
+const uint64_t SMALL_BODY_ALIGNMENT = 64;
+
+// Bodies smaller than this are not compressed.
+const uint64_t MIN_COMPRESS_SIZE = 256;
+
+// ETags are a quoted 64 bits hash in hex, the gzip one has a suffix.
+const size_t ETAG_LENGTH = 18;
+const char GZIP_ETAG_SUFFIX[] = "-gz";
+
+// FNV-1a, used for the table and the ETags.
+uint64_t fnv1a(const char* data, size_t size) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+uint64_t alignUp(uint64_t offset, uint64_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Offset of the next body of size bytes, cursor moves past it.
+uint64_t placeBody(uint64_t& cursor, uint64_t size) {
+  if (size >= BUNDLE_PAGE_SIZE) {
+    cursor = alignUp(cursor, BUNDLE_PAGE_SIZE);
+  } else if (size > 0) {
+    cursor = alignUp(cursor, SMALL_BODY_ALIGNMENT);
+    if (cursor / BUNDLE_PAGE_SIZE != (cursor + size - 1) / BUNDLE_PAGE_SIZE) {
+      cursor = alignUp(cursor, BUNDLE_PAGE_SIZE);
+    }
+  }
+  auto offset = cursor;
+  cursor += size;
+  return offset;
+}
+
+// Compress data in gzip format, return false if it doesn't save an eighth.
+bool gzipBody(const std::string& data, std::string& out) {
+  if (data.size() < MIN_COMPRESS_SIZE) return false;
+  z_stream stream{};
+  if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) !=
+      Z_OK) {
+    return false;
+  }
+  out.resize(deflateBound(&stream, data.size()));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = data.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+  stream.avail_out = out.size();
+  auto result = deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  return result == Z_STREAM_END && out.size() <= data.size() - data.size() / 8;
+}
+
+bool writeAt(int fd, const char* data, size_t size, uint64_t offset) {
+  while (size > 0) {
+    auto n = pwrite(fd, data, size, offset);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    data += n;
+    size -= n;
+    offset += n;
+  }
+  return true;
+}
+
+uint32_t crc(uint32_t value, const char* data, uint64_t size) {
+  // crc32() takes the length as uInt
+  while (size > 0) {
+    auto chunk = static_cast<uInt>(std::min<uint64_t>(size, 1 << 30));
+    value = crc32(value, reinterpret_cast<const Bytef*>(data), chunk);
+    data += chunk;
+    size -= chunk;
+  }
+  return value;
+}
+
+std::string quotedHash(uint64_t hash, const char* suffix) {
+  char etag[32];
+  snprintf(etag, sizeof(etag), "\"%016llx%s\"", static_cast<unsigned long long>(hash), suffix);
+  return etag;
+}
+}  // namespace
+
+bool AssetBundle::pack(const std::string& root, const std::string& output, const MimeTypes* mime,
+                       std::string& error) {
+  namespace fs = boost::filesystem;
+  boost::system::error_code ec;
+  std::vector<std::pair<std::string, fs::path>> files;
+  for (fs::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+    if (!fs::is_regular_file(it->status())) continue;
+    auto relative = it->path().lexically_relative(root);
+    files.emplace_back("/" + relative.generic_string(), it->path());
+  }
+  if (ec) {
+    error = root + ": " + ec.message();
+    return false;
+  }
+  std::sort(files.begin(), files.end());
+
+  // strings are laid out before the bodies are read, ETags are filled in later
+  std::string strings;
+  std::map<std::string, uint32_t> types;
+  std::vector<Entry> entries(files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    auto& path = files[i].first;
+    auto& entry = entries[i];
+    entry = Entry();
+    entry.hash = fnv1a(path.data(), path.size());
+    entry.path = strings.size();
+    entry.pathLength = path.size();
+    strings.append(path).push_back('\0');
+    entry.etag = strings.size();
+    strings.append(ETAG_LENGTH, ' ').push_back('\0');
+    entry.gzipEtag = strings.size();
+    strings.append(ETAG_LENGTH + sizeof(GZIP_ETAG_SUFFIX) - 1, ' ').push_back('\0');
+
+    std::string type = mime ? mime->lookup(path) : MimeTypes::lookupBuiltin(path);
+    auto found = types.find(type);
+    if (found == types.end()) {
+      found = types.emplace(type, strings.size()).first;
+      strings.append(type).push_back('\0');
+    }
+    entry.type = found->second;
+  }
+  strings.push_back('\0');
+
+  uint32_t slots = 1;
+  while (slots < entries.size() * 2) slots <<= 1;
+  std::vector<uint32_t> table(slots, 0);
+  for (size_t i = 0; i < entries.size(); ++i) {
+    auto index = entries[i].hash & (slots - 1);
+    while (table[index] != 0) index = (index + 1) & (slots - 1);
+    table[index] = i + 1;
+  }
+
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.count = entries.size();
+  header.slots = slots;
+  header.slotsOffset = sizeof(Header);
+  header.entriesOffset = alignUp(header.slotsOffset + slots * sizeof(uint32_t), alignof(Entry));
+  header.stringsOffset = header.entriesOffset + entries.size() * sizeof(Entry);
+  header.stringsSize = strings.size();
+
+  auto temp = output + ".tmp";
+  int fd = ::open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    error = temp + ": " + strerror(errno);
+    return false;
+  }
+  auto fail = [&](const std::string& message) {
+    error = message;
+    close(fd);
+    std::remove(temp.c_str());
+    return false;
+  };
+
+  auto cursor = alignUp(header.stringsOffset + header.stringsSize, BUNDLE_PAGE_SIZE);
+  std::string body, compressed;
+  for (size_t i = 0; i < files.size(); ++i) {
+    std::ifstream file(files[i].second.string(), std::ios::binary);
+    body.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (file.bad() || !file.is_open()) return fail(files[i].second.string() + ": can't read");
+
+    auto& entry = entries[i];
+    auto hash = fnv1a(body.data(), body.size());
+    auto etag = quotedHash(hash, "");
+    auto gzipEtag = quotedHash(hash, GZIP_ETAG_SUFFIX);
+    strings.replace(entry.etag, etag.size(), etag);
+    strings.replace(entry.gzipEtag, gzipEtag.size(), gzipEtag);
+
+    entry.bodySize = body.size();
+    entry.body = placeBody(cursor, body.size());
+    if (!writeAt(fd, body.data(), body.size(), entry.body)) return fail(temp + ": write failed");
+    if (gzipBody(body, compressed)) {
+      entry.gzipSize = compressed.size();
+      entry.gzip = placeBody(cursor, compressed.size());
+      if (!writeAt(fd, compressed.data(), compressed.size(), entry.gzip)) {
+        return fail(temp + ": write failed");
+      }
+    }
+  }
+  header.size = cursor;
+
+  std::string meta(header.stringsOffset + header.stringsSize - sizeof(Header), '\0');
+  std::memcpy(&meta[0], table.data(), slots * sizeof(uint32_t));
+  if (!entries.empty()) {
+    std::memcpy(&meta[header.entriesOffset - sizeof(Header)], entries.data(),
+                entries.size() * sizeof(Entry));
+  }
+  std::memcpy(&meta[header.stringsOffset - sizeof(Header)], strings.data(), strings.size());
+  if (ftruncate(fd, header.size) != 0 ||
+      !writeAt(fd, meta.data(), meta.size(), sizeof(Header))) {
+    return fail(temp + ": write failed");
+  }
+
+  // the checksum covers the bodies too, read back what was written
+  auto value = crc(crc32(0, nullptr, 0), meta.data(), meta.size());
+  std::vector<char> chunk(1 << 20);
+  for (uint64_t offset = sizeof(Header) + meta.size(); offset < header.size;) {
+    auto n = pread(fd, chunk.data(), std::min<uint64_t>(chunk.size(), header.size - offset),
+                   offset);
+    if (n <= 0) return fail(temp + ": read back failed");
+    value = crc(value, chunk.data(), n);
+    offset += n;
+  }
+  header.checksum = value;
+
+  if (!writeAt(fd, reinterpret_cast<const char*>(&header), sizeof(Header), 0) || fsync(fd) != 0) {
+    return fail(temp + ": write failed");
+  }
+  close(fd);
+  if (std::rename(temp.c_str(), output.c_str()) != 0) {
+    error = output + ": " + strerror(errno);
+    std::remove(temp.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::shared_ptr<const AssetBundle> AssetBundle::open(const std::string& path, std::string& error,
+                                                     bool verify) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    error = path + ": " + strerror(errno);
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+    close(fd);
+    error = path + ": not a bundle";
+    return nullptr;
+  }
+  size_t length = st.st_size;
+  void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    error = path + ": " + strerror(errno);
+    return nullptr;
+  }
+  std::shared_ptr<AssetBundle> bundle(new AssetBundle(static_cast<const char*>(mapped), length));
+
+  auto header = reinterpret_cast<const Header*>(bundle->base_);
+  auto invalid = [&](const char* reason) {
+    error = path + ": " + reason;
+    return nullptr;
+  };
+  if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) return invalid("not a bundle");
+  if (header->version != VERSION) return invalid("unsupported version");
+  if (header->size != length) return invalid("truncated");
+  if (header->slots == 0 || (header->slots & (header->slots - 1)) != 0 ||
+      header->slots <= header->count ||
+      header->slotsOffset + header->slots * sizeof(uint32_t) > length ||
+      header->entriesOffset % alignof(Entry) != 0 ||
+      header->entriesOffset + header->count * sizeof(Entry) > length ||
+      header->stringsSize == 0 || header->stringsOffset + header->stringsSize > length) {
+    return invalid("bad table");
+  }
+  if (verify && crc(crc32(0, nullptr, 0), bundle->base_ + sizeof(Header),
+                    length - sizeof(Header)) != header->checksum) {
+    return invalid("checksum mismatch");
+  }
+
+  bundle->slots_ = reinterpret_cast<const uint32_t*>(bundle->base_ + header->slotsOffset);
+  bundle->mask_ = header->slots - 1;
+  bundle->entries_ = reinterpret_cast<const Entry*>(bundle->base_ + header->entriesOffset);
+  bundle->count_ = header->count;
+  bundle->strings_ = bundle->base_ + header->stringsOffset;
+
+  // the last string byte is NUL, so every string in range is terminated
+  auto stringsSize = header->stringsSize;
+  if (bundle->strings_[stringsSize - 1] != '\0') return invalid("bad strings");
+  for (uint32_t i = 0; i <= bundle->mask_; ++i) {
+    if (bundle->slots_[i] > bundle->count_) return invalid("bad table");
+  }
+  for (uint32_t i = 0; i < bundle->count_; ++i) {
+    auto& entry = bundle->entries_[i];
+    if (entry.path + static_cast<uint64_t>(entry.pathLength) >= stringsSize ||
+        entry.etag >= stringsSize || entry.gzipEtag >= stringsSize || entry.type >= stringsSize ||
+        entry.bodySize > length || entry.body > length - entry.bodySize ||
+        entry.gzipSize > length || entry.gzip > length - entry.gzipSize) {
+      return invalid("bad entry");
+    }
+  }
+  return bundle;
+}
+
+AssetBundle::AssetBundle(const char* base, size_t length) : base_(base), length_(length) {}
+
+AssetBundle::~AssetBundle() { munmap(const_cast<char*>(base_), length_); }
+
+bool AssetBundle::find(const std::string& path, Asset& asset) const {
+  if (count_ == 0) return false;
+  auto hash = fnv1a(path.data(), path.size());
+  // there are more slots than entries, the probe always reaches an empty one
+  for (auto index = hash & mask_;; index = (index + 1) & mask_) {
+    auto slot = slots_[index];
+    if (slot == 0) return false;
+    auto& entry = entries_[slot - 1];
+    if (entry.hash != hash || entry.pathLength != path.size() ||
+        std::memcmp(strings_ + entry.path, path.data(), path.size()) != 0) {
+      continue;
+    }
+    asset.body = base_ + entry.body;
+    asset.size = entry.bodySize;
+    asset.gzip = entry.gzipSize > 0 ? base_ + entry.gzip : nullptr;
+    asset.gzipSize = entry.gzipSize;
+    asset.etag = strings_ + entry.etag;
+    asset.gzipEtag = strings_ + entry.gzipEtag;
+    asset.contentType = strings_ + entry.type;
+    return true;
+  }
+}
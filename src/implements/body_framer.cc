@@ -0,0 +1,115 @@
+#include "include/body_framer.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+
+void BodyFramer::reset(Mode mode, uint64_t length) {
+  mode_ = mode;
+  remaining_ = length;
+  chunkSizeSeen_ = false;
+  switch (mode) {
+    case Mode::NONE:
+      state_ = State::DONE;
+      break;
+    case Mode::LENGTH:
+      state_ = length > 0 ? State::DATA : State::DONE;
+      break;
+    case Mode::CHUNKED:
+      state_ = State::CHUNK_SIZE;
+      break;
+    case Mode::UNTIL_CLOSE:
+      state_ = State::UNTIL_CLOSE;
+      break;
+  }
+}
+
+size_t BodyFramer::consume(const char* data, size_t size) {
+  size_t payload = 0;
+  return advance_(data, size, nullptr, payload);
+}
+
+void BodyFramer::skip(uint64_t size) {
+  if (state_ != State::DATA || mode_ != Mode::LENGTH) return;
+  remaining_ -= std::min(size, remaining_);
+  if (remaining_ == 0) state_ = State::DONE;
+}
+
+size_t BodyFramer::decode(char* data, size_t size, size_t& payload) {
+  payload = 0;
+  return advance_(data, size, data, payload);
+}
+
+size_t BodyFramer::advance_(const char* data, size_t size, char* out, size_t& payload) {
+  size_t pos = 0;
+  while (pos < size) {
+    if (state_ == State::DONE || state_ == State::ERROR) return pos;
+    if (state_ == State::UNTIL_CLOSE || state_ == State::DATA) {
+      auto length = size - pos;
+      if (state_ == State::DATA) {
+        length = static_cast<size_t>(std::min<uint64_t>(remaining_, length));
+      }
+      // out is never ahead of data, memmove handles the overlap
+      if (out && out + payload != data + pos) std::memmove(out + payload, data + pos, length);
+      payload += length;
+      pos += length;
+      if (state_ == State::UNTIL_CLOSE) continue;
+      remaining_ -= length;
+      if (remaining_ == 0) state_ = mode_ == Mode::LENGTH ? State::DONE : State::CHUNK_DATA_CR;
+      continue;
+    }
+
+    char c = data[pos++];
+    switch (state_) {
+      case State::CHUNK_SIZE:
+        if (std::isxdigit(static_cast<unsigned char>(c))) {
+          if (remaining_ > (std::numeric_limits<uint64_t>::max() >> 4)) {
+            state_ = State::ERROR;
+            break;
+          }
+          int digit = std::isdigit(static_cast<unsigned char>(c)) ? c - '0' : (c | 0x20) - 'a' + 10;
+          remaining_ = remaining_ * 16 + digit;
+          chunkSizeSeen_ = true;
+        } else if (!chunkSizeSeen_) {
+          state_ = State::ERROR;
+        } else if (c == ';' || c == ' ' || c == '\t') {
+          state_ = State::CHUNK_EXTENSION;
+        } else if (c == '\r') {
+          state_ = State::CHUNK_SIZE_LF;
+        } else {
+          state_ = State::ERROR;
+        }
+        break;
+      case State::CHUNK_EXTENSION:
+        if (c == '\r') state_ = State::CHUNK_SIZE_LF;
+        break;
+      case State::CHUNK_SIZE_LF:
+        if (c != '\n') {
+          state_ = State::ERROR;
+        } else {
+          state_ = remaining_ == 0 ? State::TRAILER_START : State::DATA;
+        }
+        break;
+      case State::CHUNK_DATA_CR:
+        state_ = c == '\r' ? State::CHUNK_DATA_LF : State::ERROR;
+        break;
+      case State::CHUNK_DATA_LF:
+        state_ = c == '\n' ? State::CHUNK_SIZE : State::ERROR;
+        chunkSizeSeen_ = false;
+        break;
+      case State::TRAILER_START:
+        state_ = c == '\r' ? State::FINAL_LF : State::TRAILER;
+        break;
+      case State::TRAILER:
+        if (c == '\n') state_ = State::TRAILER_START;
+        break;
+      case State::FINAL_LF:
+        state_ = c == '\n' ? State::DONE : State::ERROR;
+        break;
+      default:
+        break;
+    }
+  }
+  return pos;
+}
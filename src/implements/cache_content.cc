@@ -0,0 +1,91 @@
+#include "include/CacheContent.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+CacheContent::CacheContent()
+    : content_size(0),
+      content_type("text/plain"),
+      is_ready(false),
+      is_mapped(false),
+      read_at(time(nullptr)),
+      ttl(0) {}
+
+CacheContent::~CacheContent() {}
+
+CacheContent CacheContent::fromFile(const std::string& path, size_t mmap_threshold, time_t ttl,
+                                    const char* content_type) {
+  CacheContent cc;
+  cc.ttl = ttl;
+  cc.content_type = content_type;
+
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return cc;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return cc;
+  }
+  size_t size = st.st_size;
+
+  if (size > 0 && size >= mmap_threshold) {
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return cc;
+    cc.content = std::shared_ptr<const char>(static_cast<const char*>(mapped),
+                                             [size](const char* p) {
+                                               munmap(const_cast<char*>(p), size);
+                                             });
+    cc.is_mapped = true;
+  } else {
+    auto holder = std::make_shared<std::string>(size, '\0');
+    size_t done = 0;
+    while (done < size) {
+      auto n = read(fd, &(*holder)[done], size - done);
+      if (n <= 0) break;
+      done += n;
+    }
+    close(fd);
+    if (done != size) return cc;
+    // aliasing constructor, the string is freed with the last copy
+    cc.content = std::shared_ptr<const char>(holder, holder->data());
+  }
+
+  cc.content_size = size;
+  cc.is_ready = true;
+  cc.read_at = time(nullptr);
+  return cc;
+}
+
+CacheContent CacheContent::fromMemory(std::shared_ptr<const char> content, size_t size,
+                                      const char* content_type) {
+  CacheContent cc;
+  cc.content = std::move(content);
+  cc.content_size = size;
+  cc.content_type = content_type;
+  cc.is_ready = true;
+  cc.is_mapped = true;
+  return cc;
+}
+
+const std::string CacheContent::getContent() {
+  if (!content) return std::string();
+  return std::string(content.get(), content_size);
+}
+
+const char* CacheContent::data() const { return content.get(); }
+
+size_t CacheContent::size() const { return content_size; }
+
+const char* CacheContent::contentType() const { return content_type; }
+
+bool CacheContent::isMapped() const { return is_mapped; }
+
+bool CacheContent::isValid() const { return is_ready && !isExpired(); }
+
+bool CacheContent::isPending() const { return !is_ready && !isExpired(); }
+
+bool CacheContent::isExpired() const { return ttl > 0 && time(nullptr) - read_at >= ttl; }
@@ -0,0 +1,56 @@
+#include "include/cache_warmer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+
+#include "include/static_files.hpp"
+
+struct CacheWarmer::Progress {
+  mutable std::mutex mutex;
+  mutable std::condition_variable cv;
+  size_t done = 0;
+  size_t warmed = 0;
+};
+
+CacheWarmer::CacheWarmer(std::shared_ptr<const ServerContext> context,
+                         std::vector<std::string> paths)
+    : context_(std::move(context)),
+      paths_(std::move(paths)),
+      progress_(std::make_shared<Progress>()) {}
+
+void CacheWarmer::start(ThreadPool& pool, ThreadPool::Clock::time_point deadline) {
+  for (auto& path : paths_) {
+    auto context = context_;
+    auto progress = progress_;
+    pool.dispatch([context, progress, path, deadline] {
+      auto warmed = ThreadPool::Clock::now() <= deadline && StaticFiles::warm(*context, path);
+      {
+        std::lock_guard<std::mutex> lock(progress->mutex);
+        progress->done++;
+        if (warmed) progress->warmed++;
+      }
+      progress->cv.notify_all();
+    });
+  }
+}
+
+bool CacheWarmer::wait(double fraction, ThreadPool::Clock::time_point deadline) const {
+  auto need = static_cast<size_t>(std::ceil(std::min(std::max(fraction, 0.0), 1.0) *
+                                            static_cast<double>(paths_.size())));
+  std::unique_lock<std::mutex> lock(progress_->mutex);
+  return progress_->cv.wait_until(lock, deadline, [&] { return progress_->done >= need; });
+}
+
+size_t CacheWarmer::total() const { return paths_.size(); }
+
+size_t CacheWarmer::done() const {
+  std::lock_guard<std::mutex> lock(progress_->mutex);
+  return progress_->done;
+}
+
+size_t CacheWarmer::warmed() const {
+  std::lock_guard<std::mutex> lock(progress_->mutex);
+  return progress_->warmed;
+}
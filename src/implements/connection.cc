@@ -1,12 +1,67 @@
 #include "include/connection.hpp"
 
+#include <openssl/ssl.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
 
+namespace {
+// An HTTP/2 write gathers frames up to about this many bytes.
+const size_t HTTP2_WRITE_LIMIT = 64 << 10;
+
+// A proxied response body passes through a buffer of this size.
+const size_t PROXY_BUFFER_SIZE = 16 << 10;
+
+// An upstream response head larger than this is a bad gateway.
+const size_t MAX_RESPONSE_HEAD = 64 << 10;
+
+// A body which is not spliced passes through a buffer of this size.
+const size_t UPLOAD_BUFFER_SIZE = 64 << 10;
+
+// A splice loop yields to other connections after moving this many bytes.
+const size_t SPLICE_BUDGET = 4 << 20;
+
+// The TCP socket is closed if the peer doesn't answer close_notify in time.
+const std::chrono::seconds TLS_SHUTDOWN_TIMEOUT(1);
+
+const char BAD_GATEWAY[] =
+    "HTTP/1.1 502 Bad Gateway\r\n"
+    "content-length: 0\r\n"
+    "connection: close\r\n"
+    "\r\n";
+}  // namespace
+
 boost::asio::io_context Connection::service;
 
 boost::asio::ip::tcp::socket& Connection::socket() { return socket_; };
 
-void Connection::start() { read_(); };
+void Connection::start() {
+  if (!tls_) {
+    read_();
+    return;
+  }
+
+  auto self = shared_from_this();
+  tls_->async_handshake(boost::asio::ssl::stream_base::server,
+                        strand_.wrap([this, self](boost::system::error_code ec) {
+                          if (ec) {
+                            shutdown_();
+                            return;
+                          }
+                          const unsigned char* protocol = nullptr;
+                          unsigned int length = 0;
+                          SSL_get0_alpn_selected(tls_->native_handle(), &protocol, &length);
+                          if (length == 2 && std::memcmp(protocol, "h2", 2) == 0) {
+                            startHttp2_(nullptr, 0);
+                          } else {
+                            read_();
+                          }
+                        }));
+};
 
 long Connection::during() {
   auto now = std::chrono::system_clock::now();
@@ -16,43 +71,678 @@ long Connection::during() {
 
 void Connection::read_() {
   auto self = shared_from_this();
-  boost::asio::async_read(
-      socket_, boost::asio::buffer(buffer_.get(), buffer_size_),
-      [this, self](boost::system::error_code ec, std::size_t bytes_transferred) {
-        std::string message(buffer_.get());
-        return message.find("\r\n") != std::string::npos;
+  asyncRead_(
+      boost::asio::buffer(buffer_.get(), buffer_size_),
+      [this, self](boost::system::error_code ec, std::size_t bytes_transferred) -> std::size_t {
+        // 0 means the read is completed, only the bytes of this request are checked.
+        if (ec) return 0;
+        std::string message(buffer_.get(), bytes_transferred);
+        if (message.find("\r\n\r\n") != std::string::npos) return 0;
+        return buffer_size_ - bytes_transferred;
       },
       strand_.wrap([this, self](boost::system::error_code ec, std::size_t bytes_transferred) {
-        if (!ec) {
-          auto rawBuffer = buffer_.get();
-          std::string request_str(rawBuffer, bytes_transferred - 2);
-          auto request = HttpUtils::HttpRequest(request_str);
-          auto abs_pathname = boost::filesystem::current_path() / request.pathname;
-          std::string pathStr(abs_pathname.c_str());
-          auto response = HttpUtils::HttpResponse(pathStr);
-          if (response.state_ == 200) {
-            std::ifstream file(pathStr);
-            std::string content((std::istreambuf_iterator<char>(file)),
-                                (std::istreambuf_iterator<char>()));
-            response.setMessage("OK").setContent(content);
-          } else {
-            response.setMessage("Not Found");
-          }
-          auto replyContent = response.stringify();
-          memset(rawBuffer, 0, bytes_transferred);
-          strncpy(rawBuffer, replyContent.c_str(), replyContent.size());
-          write_(replyContent.size());
+        if (ec) {
+          shutdown_();
+          return;
+        }
+        auto rawBuffer = buffer_.get();
+        if (std::memcmp(rawBuffer, Http2Session::PREFACE,
+                        std::min(bytes_transferred, Http2Session::PREFACE_SIZE)) == 0) {
+          // HTTP/2 with prior knowledge
+          startHttp2_(rawBuffer, bytes_transferred);
+          return;
+        }
+
+        if (!admit_()) return;
+        std::string request_str(rawBuffer, bytes_transferred);
+        auto headEnd = request_str.find("\r\n\r\n");
+        size_t headSize = headEnd == std::string::npos ? bytes_transferred : headEnd + 4;
+        request_str.resize(std::max<size_t>(headSize, 2) - 2);
+        auto request = HttpUtils::HttpRequest(request_str);
+        if (context_->routes && forward_(request, headSize, bytes_transferred)) return;
+        if (!tls_ && upgradeHttp2_(request)) return;
+        if ((request.method == "PUT" || request.method == "POST") &&
+            receive_(request, headSize, bytes_transferred)) {
+          return;
         }
+
+        HttpUtils::HttpResponse response;
+        auto file = respond_(request, response);
+        writeResponse_(response.stringifyHeader(), file);
       }));
 }
 
 void Connection::write_(std::size_t length) {
   auto self = shared_from_this();
-  boost::asio::async_write(
-      socket_, boost::asio::buffer(buffer_.get(), length),
+  asyncWrite_(
+      boost::asio::buffer(buffer_.get(), length),
+      strand_.wrap([this, self](boost::system::error_code ec, std::size_t /* bytes_transferred */) {
+        written_(ec);
+      }));
+}
+
+void Connection::writeResponse_(std::string header, CacheContent body) {
+  header_ = std::move(header);
+  body_ = std::move(body);
+  std::array<boost::asio::const_buffer, 2> buffers = {
+      boost::asio::buffer(header_), boost::asio::buffer(body_.data(), body_.size())};
+
+  auto self = shared_from_this();
+  asyncWrite_(
+      buffers,
       strand_.wrap([this, self](boost::system::error_code ec, std::size_t /* bytes_transferred */) {
-        if (!ec) {
-          read_();
+        body_ = CacheContent();
+        written_(ec);
+      }));
+}
+
+void Connection::written_(const boost::system::error_code& ec) {
+  ticket_.release();
+  if (!ec && !close_) {
+    read_();
+  } else {
+    shutdown_();
+  }
+}
+
+void Connection::shutdown_() {
+  if (closed_) return;
+  closed_ = true;
+  auto closeSocket = [this] {
+    boost::system::error_code ignored;
+    socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+    socket_.close(ignored);
+  };
+  if (!tls_ || !socket_.is_open()) {
+    closeSocket();
+    return;
+  }
+
+  // send close_notify, otherwise OpenSSL drops the session and it can't be resumed
+  auto self = shared_from_this();
+  shutdownTimer_ =
+      std::make_unique<boost::asio::steady_timer>(socket_.get_executor(), TLS_SHUTDOWN_TIMEOUT);
+  shutdownTimer_->async_wait(strand_.wrap([self, closeSocket](boost::system::error_code ec) {
+    // closing the socket completes the pending shutdown
+    if (!ec) closeSocket();
+  }));
+  tls_->async_shutdown(strand_.wrap([self, closeSocket](boost::system::error_code /* ec */) {
+    self->shutdownTimer_->cancel();
+    closeSocket();
+  }));
+}
+
+CacheContent Connection::respond_(const HttpUtils::HttpRequest& request,
+                                  HttpUtils::HttpResponse& response) {
+  return StaticFiles::respond(*context_, request, response);
+}
+
+ushort Connection::check_(AdmissionController::Ticket& ticket, uint32_t& retryAfter) {
+  if (context_->limiter) {
+    boost::system::error_code ec;
+    auto endpoint = socket_.remote_endpoint(ec);
+    if (!ec) {
+      retryAfter = context_->limiter->acquire(endpoint.address());
+      if (retryAfter > 0) return 429;
+    }
+  }
+  if (context_->admission) {
+    ticket = context_->admission->tryEnter();
+    if (!ticket) {
+      retryAfter = 1;
+      return 503;
+    }
+  }
+  return 0;
+}
+
+bool Connection::admit_() {
+  uint32_t retryAfter = 0;
+  switch (check_(ticket_, retryAfter)) {
+    case 429:
+      reject_(429, "Too Many Requests", retryAfter);
+      return false;
+    case 503:
+      reject_(503, "Service Unavailable", retryAfter);
+      return false;
+    default:
+      return true;
+  }
+}
+
+void Connection::reject_(ushort status, const char* message, uint32_t retryAfter) {
+  close_ = true;
+  char retry[32] = "";
+  if (retryAfter > 0) snprintf(retry, sizeof(retry), "retry-after: %u\r\n", retryAfter);
+  auto length = snprintf(buffer_.get(), buffer_size_,
+                         "HTTP/1.1 %u %s\r\n"
+                         "%s"
+                         "content-length: 0\r\n"
+                         "connection: close\r\n"
+                         "\r\n",
+                         status, message, retry);
+  write_(std::min<size_t>(length, buffer_size_));
+}
+
+bool Connection::upgradeHttp2_(const HttpUtils::HttpRequest& request) {
+  auto settings = request.header("HTTP2-Settings");
+  auto length = request.header("Content-Length");
+  if (request.header("Upgrade").find("h2c") == std::string::npos || settings.empty() ||
+      (!length.empty() && length != "0")) {
+    return false;
+  }
+
+  // stream 1 takes its own admission slot in respondHttp2_()
+  ticket_.release();
+  http2_ = std::make_unique<Http2Session>(
+      [this](const HttpUtils::HttpRequest& request) { return respondHttp2_(request); });
+  if (!http2_->upgrade(request, settings)) {
+    http2_.reset();
+    return false;
+  }
+
+  header_ =
+      "HTTP/1.1 101 Switching Protocols\r\n"
+      "connection: Upgrade\r\n"
+      "upgrade: h2c\r\n"
+      "\r\n";
+  writing_ = true;
+  auto self = shared_from_this();
+  asyncWrite_(boost::asio::buffer(header_),
+              strand_.wrap([this, self](boost::system::error_code ec, std::size_t) {
+                writing_ = false;
+                if (ec) {
+                  shutdown_();
+                } else {
+                  flushHttp2_();
+                }
+              }));
+  readHttp2_();
+  return true;
+}
+
+void Connection::startHttp2_(const char* data, size_t size) {
+  http2_ = std::make_unique<Http2Session>(
+      [this](const HttpUtils::HttpRequest& request) { return respondHttp2_(request); });
+  bool ok = size == 0 || http2_->feed(data, size);
+  flushHttp2_();
+  if (ok) readHttp2_();
+}
+
+void Connection::readHttp2_() {
+  auto self = shared_from_this();
+  asyncReadSome_(
+      boost::asio::buffer(buffer_.get(), buffer_size_),
+      strand_.wrap([this, self](boost::system::error_code ec, std::size_t bytes_transferred) {
+        if (ec) {
+          shutdown_();
+          return;
         }
+        bool ok = http2_->feed(buffer_.get(), bytes_transferred);
+        flushHttp2_();
+        if (ok) readHttp2_();
       }));
 }
+
+void Connection::flushHttp2_() {
+  if (writing_ || closed_) return;
+  http2Buffers_.clear();
+  if (http2_->collect(http2Buffers_, HTTP2_WRITE_LIMIT) == 0) {
+    if (http2_->closed()) shutdown_();
+    return;
+  }
+
+  writing_ = true;
+  auto self = shared_from_this();
+  asyncWrite_(http2Buffers_,
+              strand_.wrap([this, self](boost::system::error_code ec, std::size_t) {
+                writing_ = false;
+                http2_->consumed();
+                if (ec) {
+                  shutdown_();
+                } else {
+                  flushHttp2_();
+                }
+              }));
+}
+
+Http2Session::Response Connection::respondHttp2_(const HttpUtils::HttpRequest& request) {
+  Http2Session::Response result;
+  AdmissionController::Ticket ticket;
+  uint32_t retryAfter = 0;
+  auto status = check_(ticket, retryAfter);
+  if (status != 0) {
+    result.response.setStatus(status).setHeader("retry-after", std::to_string(retryAfter));
+    return result;
+  }
+  if (ticket) result.guard = std::make_shared<AdmissionController::Ticket>(std::move(ticket));
+  if (context_->routes && context_->routes->match(request.pathname)) {
+    // proxied bodies are streamed, which only the HTTP/1.1 path does
+    result.response.setStatus(501);
+    return result;
+  }
+  result.body = respond_(request, result.response);
+  return result;
+}
+
+bool Connection::forward_(const HttpUtils::HttpRequest& request, size_t headSize, size_t size) {
+  auto route = context_->routes->match(request.pathname);
+  if (!route) return false;
+
+  exchange_ = std::make_unique<ReverseProxy::Exchange>();
+  auto& exchange = *exchange_;
+  exchange.endpoint = route->endpoint;
+  exchange.method = request.method;
+
+  boost::system::error_code ec;
+  auto client = socket_.remote_endpoint(ec);
+  auto rawBuffer = buffer_.get();
+  if (!ReverseProxy::forwardRequestHead(std::string(rawBuffer, headSize),
+                                        ec ? std::string("unknown") : client.address().to_string(),
+                                        exchange.requestHead, exchange.request)) {
+    reject_(400, "Bad Request", 0);
+    return true;
+  }
+  // the first body bytes are sent together with the head
+  auto body = exchange.request.consume(rawBuffer + headSize, size - headSize);
+  if (exchange.request.error()) {
+    reject_(400, "Bad Request", 0);
+    return true;
+  }
+  exchange.requestHead.append(rawBuffer + headSize, body);
+  exchange.replayable =
+      ReverseProxy::idempotent(exchange.method) && body == 0 && exchange.request.done();
+  exchange.buffer = std::make_unique<char[]>(PROXY_BUFFER_SIZE);
+  exchange.bufferSize = PROXY_BUFFER_SIZE;
+
+  if (context_->upstreams) exchange.socket = context_->upstreams->acquire(exchange.endpoint);
+  if (exchange.socket) {
+    exchange.reused = true;
+    ++proxyAttempt_;
+    sendUpstream_();
+  } else {
+    connectUpstream_();
+  }
+  return true;
+}
+
+void Connection::connectUpstream_() {
+  auto& exchange = *exchange_;
+  exchange.reused = false;
+  exchange.requestWriting = false;
+  exchange.socket = std::make_unique<boost::asio::ip::tcp::socket>(socket_.get_executor());
+  auto attempt = ++proxyAttempt_;
+  auto self = shared_from_this();
+  exchange.socket->async_connect(
+      exchange.endpoint, strand_.wrap([this, self, attempt](boost::system::error_code ec) {
+        if (attempt != proxyAttempt_) return;
+        if (ec) {
+          failProxy_();
+          return;
+        }
+        exchange_->socket->set_option(boost::asio::ip::tcp::no_delay(true), ec);
+        sendUpstream_();
+      }));
+}
+
+void Connection::sendUpstream_() {
+  auto attempt = proxyAttempt_;
+  auto self = shared_from_this();
+  exchange_->requestWriting = true;
+  boost::asio::async_write(
+      *exchange_->socket, boost::asio::buffer(exchange_->requestHead),
+      strand_.wrap([this, self, attempt](boost::system::error_code ec, std::size_t) {
+        if (attempt != proxyAttempt_) return;
+        requestWritten_(ec);
+      }));
+  // the response is read while the request body is still being sent
+  readUpstream_();
+}
+
+void Connection::pumpRequest_() {
+  exchange_->requestPumped = true;
+  auto attempt = proxyAttempt_;
+  auto self = shared_from_this();
+  asyncReadSome_(
+      boost::asio::buffer(buffer_.get(), buffer_size_),
+      strand_.wrap([this, self, attempt](boost::system::error_code ec, std::size_t length) {
+        if (attempt != proxyAttempt_) return;
+        auto body = ec ? 0 : exchange_->request.consume(buffer_.get(), length);
+        if (ec || exchange_->request.error()) {
+          failProxy_();
+          return;
+        }
+        exchange_->requestWriting = true;
+        boost::asio::async_write(
+            *exchange_->socket, boost::asio::buffer(buffer_.get(), body),
+            strand_.wrap([this, self, attempt](boost::system::error_code ec, std::size_t) {
+              if (attempt != proxyAttempt_) return;
+              requestWritten_(ec);
+            }));
+      }));
+}
+
+void Connection::requestWritten_(boost::system::error_code ec) {
+  auto& exchange = *exchange_;
+  exchange.requestWriting = false;
+  if (!ec && exchange.request.done()) exchange.requestDone = true;
+  if (exchange.responseDone) {
+    // the upstream answered before the request was written
+    finishProxy_();
+  } else if (ec) {
+    failProxy_();
+  } else if (!exchange.requestDone) {
+    pumpRequest_();
+  }
+}
+
+void Connection::readUpstream_() {
+  auto attempt = proxyAttempt_;
+  auto self = shared_from_this();
+  auto& exchange = *exchange_;
+  exchange.socket->async_read_some(
+      boost::asio::buffer(exchange.buffer.get(), exchange.bufferSize),
+      strand_.wrap([this, self, attempt](boost::system::error_code ec, std::size_t length) {
+        if (attempt != proxyAttempt_) return;
+        auto& exchange = *exchange_;
+        if (ec) {
+          if (ec == boost::asio::error::eof && exchange.headForwarded &&
+              exchange.response.mode() == BodyFramer::Mode::UNTIL_CLOSE) {
+            finishProxy_();
+          } else {
+            failProxy_();
+          }
+          return;
+        }
+
+        exchange.responseStarted = true;
+        if (!exchange.headForwarded) {
+          exchange.responseHead.append(exchange.buffer.get(), length);
+          forwardHead_();
+          return;
+        }
+        auto body = exchange.response.consume(exchange.buffer.get(), length);
+        if (exchange.response.error()) {
+          failProxy_();
+          return;
+        }
+        // bytes after the response, the upstream connection is out of sync
+        if (body < length) exchange.keepAlive = false;
+        writeClient_(boost::asio::buffer(exchange.buffer.get(), body), false);
+      }));
+}
+
+void Connection::forwardHead_() {
+  auto& exchange = *exchange_;
+  auto end = exchange.responseHead.find("\r\n\r\n");
+  if (end == std::string::npos) {
+    if (exchange.responseHead.size() > MAX_RESPONSE_HEAD) {
+      failProxy_();
+    } else {
+      readUpstream_();
+    }
+    return;
+  }
+
+  unsigned status = 0;
+  if (!ReverseProxy::forwardResponseHead(exchange.responseHead.substr(0, end + 4),
+                                         exchange.method, header_, exchange.response,
+                                         exchange.keepAlive, status)) {
+    failProxy_();
+    return;
+  }
+  auto rest = exchange.responseHead.substr(end + 4);
+  exchange.pending.clear();
+  bool interim = status < 200;
+  if (interim) {
+    // Ex. 100 Continue, the final head follows
+    exchange.responseHead = rest;
+  } else {
+    exchange.headForwarded = true;
+    exchange.responseHead.clear();
+    auto body = exchange.response.consume(rest.data(), rest.size());
+    if (exchange.response.error()) {
+      failProxy_();
+      return;
+    }
+    if (body < rest.size()) exchange.keepAlive = false;
+    exchange.pending = rest.substr(0, body);
+  }
+
+  std::array<boost::asio::const_buffer, 2> buffers = {boost::asio::buffer(header_),
+                                                      boost::asio::buffer(exchange.pending)};
+  writeClient_(buffers, interim);
+}
+
+void Connection::finishProxy_() {
+  auto& exchange = *exchange_;
+  if (exchange.requestWriting) {
+    exchange.responseDone = true;
+    return;
+  }
+  ++proxyAttempt_;
+  if (exchange.keepAlive && exchange.requestDone && exchange.response.done() &&
+      context_->upstreams) {
+    context_->upstreams->release(exchange.endpoint, std::move(exchange.socket));
+  }
+  exchange.socket.reset();
+
+  // a body which is not fully read, or ends by closing, leaves the client connection unusable
+  if (!exchange.requestDone ||
+      exchange.response.mode() == BodyFramer::Mode::UNTIL_CLOSE) {
+    close_ = true;
+  }
+  written_(boost::system::error_code());
+}
+
+void Connection::failProxy_() {
+  auto& exchange = *exchange_;
+  if (exchange.reused && exchange.replayable && !exchange.responseStarted &&
+      !exchange.requestPumped) {
+    // the upstream closed the pooled connection, the whole request is still here
+    connectUpstream_();
+    return;
+  }
+
+  ++proxyAttempt_;
+  exchange.socket.reset();
+  close_ = true;
+  if (exchange.headForwarded || exchange.clientWriting) {
+    ticket_.release();
+    shutdown_();
+    return;
+  }
+  writeResponse_(BAD_GATEWAY, CacheContent());
+}
+
+bool Connection::receive_(const HttpUtils::HttpRequest& request, size_t headSize, size_t size) {
+  auto encoding = request.header("Transfer-Encoding");
+  auto length = request.header("Content-Length");
+  if (context_->maxUploadSize == 0) {
+    if (encoding.empty() && (length.empty() || length == "0")) return false;
+    reject_(405, "Method Not Allowed", 0);
+    return true;
+  }
+
+  std::transform(encoding.begin(), encoding.end(), encoding.begin(), ::tolower);
+  if (!encoding.empty()) {
+    if (encoding.size() < 7 || encoding.compare(encoding.size() - 7, 7, "chunked") != 0) {
+      reject_(501, "Not Implemented", 0);
+      return true;
+    }
+    uploadBody_.reset(BodyFramer::Mode::CHUNKED);
+  } else if (!length.empty()) {
+    if (length.size() > 18 || length.find_first_not_of("0123456789") != std::string::npos) {
+      reject_(400, "Bad Request", 0);
+      return true;
+    }
+    uploadBody_.reset(BodyFramer::Mode::LENGTH, std::stoull(length));
+  } else {
+    reject_(411, "Length Required", 0);
+    return true;
+  }
+  // refused before the body is sent if the client waits for 100 Continue
+  if (uploadBody_.remaining() > context_->maxUploadSize) {
+    reject_(413, "Payload Too Large", 0);
+    return true;
+  }
+
+  namespace fs = boost::filesystem;
+  auto& pathname = request.pathname;
+  if (pathname.empty() || pathname[0] != '/' ||
+      (pathname + "/").find("/../") != std::string::npos) {
+    reject_(403, "Forbidden", 0);
+    return true;
+  }
+  auto target = fs::current_path() / pathname;
+  boost::system::error_code ec;
+  if (pathname.back() == '/' || fs::is_directory(target, ec) ||
+      !fs::is_directory(target.parent_path(), ec)) {
+    reject_(409, "Conflict", 0);
+    return true;
+  }
+  uploadExisted_ = fs::exists(target, ec);
+
+  // a plain socket is spliced to the file, other bodies are written with O_DIRECT
+  bool splice = !tls_ && uploadBody_.mode() == BodyFramer::Mode::LENGTH;
+  upload_ = Upload::create(target.string(), !splice, uploadBody_.remaining());
+  if (!upload_) {
+    reject_(500, "Internal Server Error", 0);
+    return true;
+  }
+
+  // the first body bytes are read together with the head
+  size_t payload = 0;
+  auto rawBuffer = buffer_.get();
+  uploadBody_.decode(rawBuffer + headSize, size - headSize, payload);
+  if (!store_(rawBuffer + headSize, payload)) return true;
+
+  auto expect = request.header("Expect");
+  std::transform(expect.begin(), expect.end(), expect.begin(), ::tolower);
+  if (size == headSize && !uploadBody_.done() && expect == "100-continue") {
+    header_ = "HTTP/1.1 100 Continue\r\n\r\n";
+    auto self = shared_from_this();
+    asyncWrite_(boost::asio::buffer(header_),
+                strand_.wrap([this, self](boost::system::error_code ec, std::size_t) {
+                  if (ec) {
+                    abortUpload_();
+                  } else {
+                    receiveBody_();
+                  }
+                }));
+    return true;
+  }
+  receiveBody_();
+  return true;
+}
+
+void Connection::receiveBody_() {
+  if (uploadBody_.done()) {
+    finishUpload_();
+  } else if (!tls_ && uploadBody_.mode() == BodyFramer::Mode::LENGTH && !upload_->direct()) {
+    spliceBody_();
+  } else {
+    readBody_();
+  }
+}
+
+void Connection::spliceBody_() {
+  boost::system::error_code ec;
+  const bool nonBlocking = socket_.native_non_blocking();
+  socket_.native_non_blocking(true, ec);
+  size_t budget = SPLICE_BUDGET;
+  ssize_t moved = 0;
+  int error = 0;
+  while (!uploadBody_.done() && budget > 0) {
+    auto want = static_cast<size_t>(std::min<uint64_t>(uploadBody_.remaining(), budget));
+    moved = upload_->spliceFrom(socket_.native_handle(), want);
+    if (moved <= 0) {
+      error = errno;
+      break;
+    }
+    uploadBody_.skip(moved);
+    budget -= moved;
+  }
+  // hand the socket back in the mode it came in, whichever path continues the upload
+  socket_.native_non_blocking(nonBlocking, ec);
+
+  auto self = shared_from_this();
+  if (uploadBody_.done()) {
+    finishUpload_();
+  } else if (moved > 0) {
+    strand_.post([this, self] { spliceBody_(); });
+  } else if (moved == 0) {
+    abortUpload_();
+  } else if (error == EAGAIN || error == EWOULDBLOCK) {
+    socket_.async_wait(boost::asio::ip::tcp::socket::wait_read,
+                       strand_.wrap([this, self](boost::system::error_code ec) {
+                         if (ec) {
+                           abortUpload_();
+                         } else {
+                           spliceBody_();
+                         }
+                       }));
+  } else if (error == EINVAL || error == ENOSYS) {
+    // splice is not supported here, nothing was moved
+    readBody_();
+  } else {
+    failUpload_(500, "Internal Server Error");
+  }
+}
+
+void Connection::readBody_() {
+  if (!uploadBuffer_) uploadBuffer_ = std::make_unique<char[]>(UPLOAD_BUFFER_SIZE);
+  auto self = shared_from_this();
+  asyncReadSome_(
+      boost::asio::buffer(uploadBuffer_.get(), UPLOAD_BUFFER_SIZE),
+      strand_.wrap([this, self](boost::system::error_code ec, std::size_t length) {
+        if (ec) {
+          abortUpload_();
+          return;
+        }
+        size_t payload = 0;
+        uploadBody_.decode(uploadBuffer_.get(), length, payload);
+        if (store_(uploadBuffer_.get(), payload)) receiveBody_();
+      }));
+}
+
+bool Connection::store_(const char* data, size_t size) {
+  if (uploadBody_.error()) {
+    failUpload_(400, "Bad Request");
+  } else if (upload_->size() + size > context_->maxUploadSize) {
+    failUpload_(413, "Payload Too Large");
+  } else if (!upload_->write(data, size)) {
+    failUpload_(500, "Internal Server Error");
+  } else {
+    return true;
+  }
+  return false;
+}
+
+void Connection::finishUpload_() {
+  if (!upload_->commit()) {
+    failUpload_(500, "Internal Server Error");
+    return;
+  }
+  if (context_->cache) context_->cache->erase(upload_->target());
+  upload_.reset();
+
+  HttpUtils::HttpResponse response;
+  if (uploadExisted_) {
+    response.setStatus(200).setMessage("OK");
+  } else {
+    response.setStatus(201).setMessage("Created");
+  }
+  writeResponse_(response.setContentLength(0).stringifyHeader(), CacheContent());
+}
+
+void Connection::failUpload_(ushort status, const char* message) {
+  upload_.reset();
+  reject_(status, message, 0);
+}
+
+void Connection::abortUpload_() {
+  upload_.reset();
+  ticket_.release();
+  shutdown_();
+}
@@ -0,0 +1,220 @@
+#include "include/coro_connection.hpp"
+
+#include <array>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <cstdio>
+
+#include "include/static_files.hpp"
+
+namespace {
+/* Allocator over the handler memory of a connection */
+template <typename T>
+class HandlerAllocator {
+ public:
+  using value_type = T;
+
+  explicit HandlerAllocator(CoroConnection::HandlerMemory& memory) : memory_(&memory) {}
+
+  template <typename U>
+  HandlerAllocator(const HandlerAllocator<U>& other) : memory_(other.memory_) {}
+
+  T* allocate(size_t n) { return static_cast<T*>(memory_->allocate(sizeof(T) * n)); }
+  void deallocate(T* pointer, size_t /* n */) { memory_->deallocate(pointer); }
+
+  template <typename U>
+  bool operator==(const HandlerAllocator<U>& other) const {
+    return memory_ == other.memory_;
+  }
+  template <typename U>
+  bool operator!=(const HandlerAllocator<U>& other) const {
+    return memory_ != other.memory_;
+  }
+
+ private:
+  template <typename U>
+  friend class HandlerAllocator;
+
+  CoroConnection::HandlerMemory* memory_;
+};
+
+/* Handler of use_awaitable, which allocates from the memory of the connection */
+template <typename Handler>
+class RecycledHandler {
+ public:
+  using executor_type = boost::asio::associated_executor_t<Handler>;
+  using allocator_type = HandlerAllocator<void>;
+
+  RecycledHandler(Handler handler, CoroConnection::HandlerMemory& memory)
+      : handler_(std::move(handler)), memory_(&memory) {}
+
+  executor_type get_executor() const noexcept {
+    return boost::asio::get_associated_executor(handler_);
+  }
+
+  allocator_type get_allocator() const noexcept { return allocator_type(*memory_); }
+
+  template <typename... Args>
+  void operator()(Args&&... args) {
+    handler_(std::forward<Args>(args)...);
+  }
+
+ private:
+  Handler handler_;
+  CoroConnection::HandlerMemory* memory_;
+};
+
+/* Completion token, co_await an operation like use_awaitable, its handler uses memory */
+struct UseRecycled {
+  CoroConnection::HandlerMemory* memory;
+};
+
+const char TOO_MANY_REQUESTS[] =
+    "HTTP/1.1 429 Too Many Requests\r\n"
+    "retry-after: %u\r\n"
+    "content-length: 0\r\n"
+    "connection: close\r\n"
+    "\r\n";
+
+const char SERVICE_UNAVAILABLE[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "retry-after: 1\r\n"
+    "content-length: 0\r\n"
+    "connection: close\r\n"
+    "\r\n";
+}  // namespace
+
+namespace boost {
+namespace asio {
+template <typename Signature>
+class async_result<UseRecycled, Signature> {
+ public:
+  template <typename Initiation, typename... Args>
+  static auto initiate(Initiation initiation, UseRecycled token, Args... args) {
+    return async_initiate<const use_awaitable_t<>&, Signature>(
+        [initiation = std::move(initiation), memory = token.memory](auto&& handler,
+                                                                     auto&&... args) mutable {
+          using Handler = std::decay_t<decltype(handler)>;
+          std::move(initiation)(RecycledHandler<Handler>(std::move(handler), *memory),
+                                std::forward<decltype(args)>(args)...);
+        },
+        use_awaitable, std::move(args)...);
+  }
+};
+}  // namespace asio
+}  // namespace boost
+
+struct CoroConnection::Loop {
+  /**
+   * Read a head, answer it, and again until the client closes or asks to close,
+   * or a request has a body, which is not read.
+   */
+  static boost::asio::awaitable<void> run(std::shared_ptr<CoroConnection> self);
+
+  /**
+   * Same as Connection::check_(), return 0 if the request is admitted,
+   * otherwise write the 429 or 503 response to header_.
+   */
+  static ushort check(CoroConnection& conn, AdmissionController::Ticket& ticket);
+};
+
+void* CoroConnection::HandlerMemory::allocate(size_t size) {
+  if (size <= SLOT_SIZE) {
+    for (size_t i = 0; i < SLOTS; ++i) {
+      if (used_[i]) continue;
+      used_[i] = true;
+      allocations_++;
+      return &slots_[i];
+    }
+  }
+  fallbacks_++;
+  return ::operator new(size);
+}
+
+void CoroConnection::HandlerMemory::deallocate(void* pointer) {
+  for (size_t i = 0; i < SLOTS; ++i) {
+    if (pointer != &slots_[i]) continue;
+    used_[i] = false;
+    return;
+  }
+  ::operator delete(pointer);
+}
+
+CoroConnection::CoroConnection(boost::asio::io_context& io_context,
+                               std::shared_ptr<const ServerContext> context, size_t bufferSize)
+    : socket_(io_context), context_(std::move(context)), bufferSize_(bufferSize) {}
+
+boost::asio::ip::tcp::socket& CoroConnection::socket() { return socket_; }
+
+void CoroConnection::start() {
+  boost::asio::co_spawn(socket_.get_executor(), Loop::run(shared_from_this()),
+                        boost::asio::detached);
+}
+
+ushort CoroConnection::Loop::check(CoroConnection& conn, AdmissionController::Ticket& ticket) {
+  auto& context = *conn.context_;
+  if (context.limiter) {
+    boost::system::error_code ec;
+    auto endpoint = conn.socket_.remote_endpoint(ec);
+    uint32_t retryAfter = ec ? 0 : context.limiter->acquire(endpoint.address());
+    if (retryAfter > 0) {
+      char response[sizeof(TOO_MANY_REQUESTS) + 16];
+      snprintf(response, sizeof(response), TOO_MANY_REQUESTS, retryAfter);
+      conn.header_ = response;
+      return 429;
+    }
+  }
+  if (context.admission) {
+    ticket = context.admission->tryEnter();
+    if (!ticket) {
+      conn.header_ = SERVICE_UNAVAILABLE;
+      return 503;
+    }
+  }
+  return 0;
+}
+
+boost::asio::awaitable<void> CoroConnection::Loop::run(std::shared_ptr<CoroConnection> self) {
+  auto& conn = *self;
+  UseRecycled recycled{&conn.memory_};
+  try {
+    while (true) {
+      auto headSize = co_await boost::asio::async_read_until(
+          conn.socket_, boost::asio::dynamic_buffer(conn.input_, conn.bufferSize_), "\r\n\r\n",
+          recycled);
+
+      AdmissionController::Ticket ticket;
+      if (check(conn, ticket) != 0) {
+        co_await boost::asio::async_write(conn.socket_, boost::asio::buffer(conn.header_),
+                                          recycled);
+        break;
+      }
+
+      std::string head = conn.input_.substr(0, headSize - 2);
+      conn.input_.erase(0, headSize);
+      HttpUtils::HttpRequest request(head);
+      auto length = request.header("Content-Length");
+      auto connection = request.header("Connection");
+      // the body is not read, so the next request can't be found after it
+      bool close = (!length.empty() && length != "0") ||
+                   !request.header("Transfer-Encoding").empty() ||
+                   connection.find("close") != std::string::npos;
+
+      HttpUtils::HttpResponse response;
+      auto body = StaticFiles::respond(*conn.context_, request, response);
+      if (close) response.setHeader("connection", "close");
+      conn.header_ = response.stringifyHeader();
+      std::array<boost::asio::const_buffer, 2> buffers = {
+          boost::asio::buffer(conn.header_), boost::asio::buffer(body.data(), body.size())};
+      co_await boost::asio::async_write(conn.socket_, buffers, recycled);
+      if (close) break;
+    }
+  } catch (const boost::system::system_error&) {
+    // closed by the client, or the head doesn't fit in bufferSize
+  }
+
+  boost::system::error_code ignored;
+  conn.socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+  conn.socket_.close(ignored);
+}
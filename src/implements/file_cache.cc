@@ -0,0 +1,149 @@
+#include "include/file_cache.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+// The protected segment may use this share of a shard.
+const double PROTECTED_RATIO = 0.8;
+}  // namespace
+
+double FileCache::Stats::hitRatio(size_t sizeClass) const {
+  auto total = hits[sizeClass] + misses[sizeClass];
+  return total == 0 ? 0 : static_cast<double>(hits[sizeClass]) / total;
+}
+
+FileCache::FileCache(size_t capacity, size_t maxObjectSize, size_t shardSize) {
+  size_t size = 1;
+  while (size < shardSize) size <<= 1;
+  for (size_t i = 0; i < size; ++i) {
+    shards_.emplace_back(new Shard());
+  }
+
+  shardCapacity_ = capacity / size;
+  protectedCapacity_ = shardCapacity_ * PROTECTED_RATIO;
+  maxObjectSize_ = maxObjectSize > 0 ? std::min(maxObjectSize, shardCapacity_) : shardCapacity_ / 8;
+}
+
+size_t FileCache::sizeClass(size_t size) {
+  if (size <= (4 << 10)) return 0;
+  if (size <= (64 << 10)) return 1;
+  if (size <= (1 << 20)) return 2;
+  return 3;
+}
+
+size_t FileCache::maxObjectSize() const { return maxObjectSize_; }
+
+FileCache::Shard& FileCache::shardOf_(const std::string& path) {
+  return *shards_[std::hash<std::string>()(path) & (shards_.size() - 1)];
+}
+
+bool FileCache::find(const std::string& path, CacheContent& result) {
+  auto& shard = shardOf_(path);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  auto found = shard.index.find(path);
+  if (found == shard.index.end()) return false;
+
+  auto it = found->second;
+  if (!it->content.isValid()) {
+    remove_(shard, it);
+    return false;
+  }
+
+  auto size = it->content.size();
+  if (it->segment == PROBATION) {
+    // second hit, promote to protected, and demote the protected tail if it's full
+    shard.protect.splice(shard.protect.begin(), shard.probation, it);
+    it->segment = PROTECTED;
+    shard.protectedBytes += size;
+    while (shard.protectedBytes > protectedCapacity_ && shard.protect.size() > 1) {
+      auto last = std::prev(shard.protect.end());
+      shard.probation.splice(shard.probation.begin(), shard.protect, last);
+      last->segment = PROBATION;
+      shard.protectedBytes -= last->content.size();
+    }
+  } else {
+    shard.protect.splice(shard.protect.begin(), shard.protect, it);
+  }
+
+  ++shard.stats.hits[sizeClass(size)];
+  result = it->content;
+  return true;
+}
+
+bool FileCache::put(const std::string& path, const CacheContent& content) {
+  auto size = content.size();
+  auto& shard = shardOf_(path);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  ++shard.stats.misses[sizeClass(size)];
+  return insert_(shard, path, content);
+}
+
+bool FileCache::prefill(const std::string& path, const CacheContent& content) {
+  auto& shard = shardOf_(path);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  if (shard.index.count(path)) return true;
+  return insert_(shard, path, content);
+}
+
+bool FileCache::insert_(Shard& shard, const std::string& path, const CacheContent& content) {
+  auto size = content.size();
+  auto found = shard.index.find(path);
+  if (found != shard.index.end()) remove_(shard, found->second);
+
+  if (!content.isValid() || content.isMapped() || size > maxObjectSize_) return false;
+
+  shard.probation.push_front(Entry{path, content, PROBATION});
+  shard.index[path] = shard.probation.begin();
+  shard.bytes += size;
+  evict_(shard);
+  return true;
+}
+
+void FileCache::erase(const std::string& path) {
+  auto& shard = shardOf_(path);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  auto found = shard.index.find(path);
+  if (found != shard.index.end()) remove_(shard, found->second);
+}
+
+FileCache::Stats FileCache::stats() const {
+  Stats total;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    for (size_t i = 0; i < SIZE_CLASSES; ++i) {
+      total.hits[i] += shard->stats.hits[i];
+      total.misses[i] += shard->stats.misses[i];
+      total.evictions[i] += shard->stats.evictions[i];
+    }
+    total.entries += shard->index.size();
+    total.bytes += shard->bytes;
+  }
+  return total;
+}
+
+void FileCache::remove_(Shard& shard, EntryList::iterator it) {
+  auto size = it->content.size();
+  shard.bytes -= size;
+  shard.index.erase(it->path);
+  if (it->segment == PROTECTED) {
+    shard.protectedBytes -= size;
+    shard.protect.erase(it);
+  } else {
+    shard.probation.erase(it);
+  }
+}
+
+void FileCache::evict_(Shard& shard) {
+  while (shard.bytes > shardCapacity_) {
+    auto& segment = shard.probation.empty() ? shard.protect : shard.probation;
+    if (segment.empty()) return;
+    auto victim = std::prev(segment.end());
+    ++shard.stats.evictions[sizeClass(victim->content.size())];
+    remove_(shard, victim);
+  }
+}
@@ -0,0 +1,419 @@
+#include "include/hpack.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+// Each entry costs its name, its value and 32 bytes, RFC 7541 section 4.1.
+const size_t ENTRY_OVERHEAD = 32;
+
+// Integers larger than this are rejected by the decoder.
+const uint64_t MAX_INTEGER = (1ULL << 32) - 1;
+
+const Hpack::Header STATIC_TABLE[] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+const size_t STATIC_SIZE = sizeof(STATIC_TABLE) / sizeof(STATIC_TABLE[0]);
+
+// Values of these headers differ on every response, adding them to the table only evicts others.
+const char* const NOT_INDEXED[] = {"content-length", "date", "etag", "last-modified",
+                                   "set-cookie", "authorization"};
+
+struct HuffmanCode {
+  uint32_t code;
+  uint8_t bits;
+};
+
+// RFC 7541 Appendix B, index is the symbol, 256 is EOS.
+const HuffmanCode HUFFMAN_TABLE[257] = {
+    {0x1ff8, 13},     {0x7fffd8, 23},   {0xfffffe2, 28},  {0xfffffe3, 28},  {0xfffffe4, 28},
+    {0xfffffe5, 28},  {0xfffffe6, 28},  {0xfffffe7, 28},  {0xfffffe8, 28},  {0xffffea, 24},
+    {0x3ffffffc, 30}, {0xfffffe9, 28},  {0xfffffea, 28},  {0x3ffffffd, 30}, {0xfffffeb, 28},
+    {0xfffffec, 28},  {0xfffffed, 28},  {0xfffffee, 28},  {0xfffffef, 28},  {0xffffff0, 28},
+    {0xffffff1, 28},  {0xffffff2, 28},  {0x3ffffffe, 30}, {0xffffff3, 28},  {0xffffff4, 28},
+    {0xffffff5, 28},  {0xffffff6, 28},  {0xffffff7, 28},  {0xffffff8, 28},  {0xffffff9, 28},
+    {0xffffffa, 28},  {0xffffffb, 28},  {0x14, 6},        {0x3f8, 10},      {0x3f9, 10},
+    {0xffa, 12},      {0x1ff9, 13},     {0x15, 6},        {0xf8, 8},        {0x7fa, 11},
+    {0x3fa, 10},      {0x3fb, 10},      {0xf9, 8},        {0x7fb, 11},      {0xfa, 8},
+    {0x16, 6},        {0x17, 6},        {0x18, 6},        {0x0, 5},         {0x1, 5},
+    {0x2, 5},         {0x19, 6},        {0x1a, 6},        {0x1b, 6},        {0x1c, 6},
+    {0x1d, 6},        {0x1e, 6},        {0x1f, 6},        {0x5c, 7},        {0xfb, 8},
+    {0x7ffc, 15},     {0x20, 6},        {0xffb, 12},      {0x3fc, 10},      {0x1ffa, 13},
+    {0x21, 6},        {0x5d, 7},        {0x5e, 7},        {0x5f, 7},        {0x60, 7},
+    {0x61, 7},        {0x62, 7},        {0x63, 7},        {0x64, 7},        {0x65, 7},
+    {0x66, 7},        {0x67, 7},        {0x68, 7},        {0x69, 7},        {0x6a, 7},
+    {0x6b, 7},        {0x6c, 7},        {0x6d, 7},        {0x6e, 7},        {0x6f, 7},
+    {0x70, 7},        {0x71, 7},        {0x72, 7},        {0xfc, 8},        {0x73, 7},
+    {0xfd, 8},        {0x1ffb, 13},     {0x7fff0, 19},    {0x1ffc, 13},     {0x3ffc, 14},
+    {0x22, 6},        {0x7ffd, 15},     {0x3, 5},         {0x23, 6},        {0x4, 5},
+    {0x24, 6},        {0x5, 5},         {0x25, 6},        {0x26, 6},        {0x27, 6},
+    {0x6, 5},         {0x74, 7},        {0x75, 7},        {0x28, 6},        {0x29, 6},
+    {0x2a, 6},        {0x7, 5},         {0x2b, 6},        {0x76, 7},        {0x2c, 6},
+    {0x8, 5},         {0x9, 5},         {0x2d, 6},        {0x77, 7},        {0x78, 7},
+    {0x79, 7},        {0x7a, 7},        {0x7b, 7},        {0x7ffe, 15},     {0x7fc, 11},
+    {0x3ffd, 14},     {0x1ffd, 13},     {0xffffffc, 28},  {0xfffe6, 20},    {0x3fffd2, 22},
+    {0xfffe7, 20},    {0xfffe8, 20},    {0x3fffd3, 22},   {0x3fffd4, 22},   {0x3fffd5, 22},
+    {0x7fffd9, 23},   {0x3fffd6, 22},   {0x7fffda, 23},   {0x7fffdb, 23},   {0x7fffdc, 23},
+    {0x7fffdd, 23},   {0x7fffde, 23},   {0xffffeb, 24},   {0x7fffdf, 23},   {0xffffec, 24},
+    {0xffffed, 24},   {0x3fffd7, 22},   {0x7fffe0, 23},   {0xffffee, 24},   {0x7fffe1, 23},
+    {0x7fffe2, 23},   {0x7fffe3, 23},   {0x7fffe4, 23},   {0x1fffdc, 21},   {0x3fffd8, 22},
+    {0x7fffe5, 23},   {0x3fffd9, 22},   {0x7fffe6, 23},   {0x7fffe7, 23},   {0xffffef, 24},
+    {0x3fffda, 22},   {0x1fffdd, 21},   {0xfffe9, 20},    {0x3fffdb, 22},   {0x3fffdc, 22},
+    {0x7fffe8, 23},   {0x7fffe9, 23},   {0x1fffde, 21},   {0x7fffea, 23},   {0x3fffdd, 22},
+    {0x3fffde, 22},   {0xfffff0, 24},   {0x1fffdf, 21},   {0x3fffdf, 22},   {0x7fffeb, 23},
+    {0x7fffec, 23},   {0x1fffe0, 21},   {0x1fffe1, 21},   {0x3fffe0, 22},   {0x1fffe2, 21},
+    {0x7fffed, 23},   {0x3fffe1, 22},   {0x7fffee, 23},   {0x7fffef, 23},   {0xfffea, 20},
+    {0x3fffe2, 22},   {0x3fffe3, 22},   {0x3fffe4, 22},   {0x7ffff0, 23},   {0x3fffe5, 22},
+    {0x3fffe6, 22},   {0x7ffff1, 23},   {0x3ffffe0, 26},  {0x3ffffe1, 26},  {0xfffeb, 20},
+    {0x7fff1, 19},    {0x3fffe7, 22},   {0x7ffff2, 23},   {0x3fffe8, 22},   {0x1ffffec, 25},
+    {0x3ffffe2, 26},  {0x3ffffe3, 26},  {0x3ffffe4, 26},  {0x7ffffde, 27},  {0x7ffffdf, 27},
+    {0x3ffffe5, 26},  {0xfffff1, 24},   {0x1ffffed, 25},  {0x7fff2, 19},    {0x1fffe3, 21},
+    {0x3ffffe6, 26},  {0x7ffffe0, 27},  {0x7ffffe1, 27},  {0x3ffffe7, 26},  {0x7ffffe2, 27},
+    {0xfffff2, 24},   {0x1fffe4, 21},   {0x1fffe5, 21},   {0x3ffffe8, 26},  {0x3ffffe9, 26},
+    {0xffffffd, 28},  {0x7ffffe3, 27},  {0x7ffffe4, 27},  {0x7ffffe5, 27},  {0xfffec, 20},
+    {0xfffff3, 24},   {0xfffed, 20},    {0x1fffe6, 21},   {0x3fffe9, 22},   {0x1fffe7, 21},
+    {0x1fffe8, 21},   {0x7ffff3, 23},   {0x3fffea, 22},   {0x3fffeb, 22},   {0x1ffffee, 25},
+    {0x1ffffef, 25},  {0xfffff4, 24},   {0xfffff5, 24},   {0x3ffffea, 26},  {0x7ffff4, 23},
+    {0x3ffffeb, 26},  {0x7ffffe6, 27},  {0x3ffffec, 26},  {0x3ffffed, 26},  {0x7ffffe7, 27},
+    {0x7ffffe8, 27},  {0x7ffffe9, 27},  {0x7ffffea, 27},  {0x7ffffeb, 27},  {0xffffffe, 28},
+    {0x7ffffec, 27},  {0x7ffffed, 27},  {0x7ffffee, 27},  {0x7ffffef, 27},  {0x7fffff0, 27},
+    {0x3ffffee, 26},  {0x3fffffff, 30},
+};
+
+const uint8_t HUFFMAN_MIN_BITS = 5;
+const uint8_t HUFFMAN_MAX_BITS = 30;
+const uint16_t HUFFMAN_EOS = 256;
+
+/**
+ * The code is canonical, codes of the same length are consecutive and ordered by symbol,
+ * so a code of length n is decoded by its distance from the first code of length n.
+ */
+struct CanonicalTable {
+  std::array<uint32_t, HUFFMAN_MAX_BITS + 1> first{};
+  std::array<uint32_t, HUFFMAN_MAX_BITS + 1> count{};
+  std::array<uint16_t, HUFFMAN_MAX_BITS + 1> offset{};
+  std::array<uint16_t, 257> symbols{};
+
+  CanonicalTable() {
+    std::array<uint16_t, 257> order;
+    for (uint16_t i = 0; i < 257; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [](uint16_t a, uint16_t b) {
+      return HUFFMAN_TABLE[a].bits != HUFFMAN_TABLE[b].bits
+                 ? HUFFMAN_TABLE[a].bits < HUFFMAN_TABLE[b].bits
+                 : HUFFMAN_TABLE[a].code < HUFFMAN_TABLE[b].code;
+    });
+    for (uint16_t i = 0; i < 257; ++i) {
+      auto& code = HUFFMAN_TABLE[order[i]];
+      if (count[code.bits]++ == 0) {
+        first[code.bits] = code.code;
+        offset[code.bits] = i;
+      }
+      symbols[i] = order[i];
+    }
+  }
+};
+
+const CanonicalTable& canonical() {
+  static const CanonicalTable table;
+  return table;
+}
+
+size_t entrySize(const std::string& name, const std::string& value) {
+  return name.size() + value.size() + ENTRY_OVERHEAD;
+}
+
+bool decodeString(const uint8_t* data, size_t size, size_t& pos, std::string& out) {
+  if (pos >= size) return false;
+  bool huffman = data[pos] & 0x80;
+  uint64_t length;
+  if (!Hpack::decodeInteger(data, size, pos, 7, length)) return false;
+  if (length > size - pos) return false;
+
+  out.clear();
+  if (huffman) {
+    if (!Hpack::huffmanDecode(data + pos, length, out)) return false;
+  } else {
+    out.assign(reinterpret_cast<const char*>(data + pos), length);
+  }
+  pos += length;
+  return true;
+}
+
+void encodeString(const std::string& value, std::string& out) {
+  auto huffman = Hpack::huffmanLength(value);
+  if (huffman < value.size()) {
+    Hpack::encodeInteger(huffman, 7, 0x80, out);
+    Hpack::huffmanEncode(value, out);
+  } else {
+    Hpack::encodeInteger(value.size(), 7, 0x00, out);
+    out += value;
+  }
+}
+
+}  // namespace
+
+void Hpack::DynamicTable::add(const std::string& name, const std::string& value) {
+  auto size = entrySize(name, value);
+  if (size > maxSize_) {
+    // an entry larger than the table empties the table, RFC 7541 section 4.4
+    entries_.clear();
+    size_ = 0;
+    return;
+  }
+  entries_.emplace_front(name, value);
+  size_ += size;
+  evict_();
+}
+
+void Hpack::DynamicTable::setMaxSize(size_t maxSize) {
+  maxSize_ = maxSize;
+  evict_();
+}
+
+void Hpack::DynamicTable::evict_() {
+  while (size_ > maxSize_ && !entries_.empty()) {
+    size_ -= entrySize(entries_.back().first, entries_.back().second);
+    entries_.pop_back();
+  }
+}
+
+void Hpack::encodeInteger(uint64_t value, uint8_t prefixBits, uint8_t first, std::string& out) {
+  uint64_t limit = (1u << prefixBits) - 1;
+  if (value < limit) {
+    out.push_back(static_cast<char>(first | value));
+    return;
+  }
+  out.push_back(static_cast<char>(first | limit));
+  value -= limit;
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+bool Hpack::decodeInteger(const uint8_t* data, size_t size, size_t& pos, uint8_t prefixBits,
+                          uint64_t& value) {
+  if (pos >= size) return false;
+  uint64_t limit = (1u << prefixBits) - 1;
+  value = data[pos++] & limit;
+  if (value < limit) return true;
+
+  for (uint8_t shift = 0; pos < size; shift += 7) {
+    auto byte = data[pos++];
+    value += static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (value > MAX_INTEGER) return false;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+bool Hpack::huffmanDecode(const uint8_t* data, size_t size, std::string& out) {
+  auto& table = canonical();
+  uint32_t code = 0;
+  uint8_t bits = 0;
+  for (size_t i = 0; i < size; ++i) {
+    for (int bit = 7; bit >= 0; --bit) {
+      code = (code << 1) | ((data[i] >> bit) & 1);
+      ++bits;
+      if (bits < HUFFMAN_MIN_BITS) continue;
+      if (bits > HUFFMAN_MAX_BITS) return false;
+      if (table.count[bits] > 0 && code >= table.first[bits] &&
+          code - table.first[bits] < table.count[bits]) {
+        auto symbol = table.symbols[table.offset[bits] + code - table.first[bits]];
+        if (symbol == HUFFMAN_EOS) return false;
+        out.push_back(static_cast<char>(symbol));
+        code = 0;
+        bits = 0;
+      }
+    }
+  }
+  // padding is the most significant bits of EOS, which are all ones, and shorter than a byte
+  return bits < 8 && code == (1u << bits) - 1;
+}
+
+void Hpack::huffmanEncode(const std::string& in, std::string& out) {
+  uint64_t buffer = 0;
+  uint8_t bits = 0;
+  for (unsigned char c : in) {
+    auto& code = HUFFMAN_TABLE[c];
+    buffer = (buffer << code.bits) | code.code;
+    bits += code.bits;
+    while (bits >= 8) {
+      bits -= 8;
+      out.push_back(static_cast<char>(buffer >> bits));
+    }
+  }
+  if (bits > 0) {
+    out.push_back(static_cast<char>((buffer << (8 - bits)) | (0xff >> bits)));
+  }
+}
+
+size_t Hpack::huffmanLength(const std::string& in) {
+  size_t bits = 0;
+  for (unsigned char c : in) bits += HUFFMAN_TABLE[c].bits;
+  return (bits + 7) / 8;
+}
+
+Hpack::Decoder::Decoder(size_t maxTableSize, size_t maxListSize)
+    : table_(maxTableSize), maxTableSize_(maxTableSize), maxListSize_(maxListSize) {}
+
+bool Hpack::Decoder::lookup_(uint64_t index, Header& header) const {
+  if (index == 0) return false;
+  if (index <= STATIC_SIZE) {
+    header = STATIC_TABLE[index - 1];
+    return true;
+  }
+  index -= STATIC_SIZE + 1;
+  if (index >= table_.count()) return false;
+  header = table_.get(index);
+  return true;
+}
+
+bool Hpack::Decoder::decode(const uint8_t* data, size_t size, HeaderList& headers) {
+  size_t pos = 0;
+  size_t listSize = 0;
+  bool headerSeen = false;
+  while (pos < size) {
+    auto first = data[pos];
+    Header header;
+    uint64_t index;
+
+    if (first & 0x80) {
+      // indexed header field
+      if (!decodeInteger(data, size, pos, 7, index) || !lookup_(index, header)) return false;
+    } else if ((first & 0xe0) == 0x20) {
+      // dynamic table size update, only allowed before the first header
+      if (headerSeen || !decodeInteger(data, size, pos, 5, index) || index > maxTableSize_) {
+        return false;
+      }
+      table_.setMaxSize(index);
+      continue;
+    } else {
+      // literal, with incremental indexing (01), without indexing (0000) or never indexed (0001)
+      bool indexing = (first & 0xc0) == 0x40;
+      if (!decodeInteger(data, size, pos, indexing ? 6 : 4, index)) return false;
+      if (index > 0) {
+        if (!lookup_(index, header)) return false;
+      } else if (!decodeString(data, size, pos, header.first)) {
+        return false;
+      }
+      if (!decodeString(data, size, pos, header.second)) return false;
+      if (indexing) table_.add(header.first, header.second);
+    }
+
+    headerSeen = true;
+    listSize += entrySize(header.first, header.second);
+    if (listSize > maxListSize_) return false;
+    headers.push_back(std::move(header));
+  }
+  return true;
+}
+
+Hpack::Encoder::Encoder(size_t maxTableSize) : table_(maxTableSize), pendingSizeUpdate_(false) {}
+
+void Hpack::Encoder::setMaxTableSize(size_t maxTableSize) {
+  if (maxTableSize == table_.maxSize()) return;
+  table_.setMaxSize(maxTableSize);
+  pendingSizeUpdate_ = true;
+}
+
+void Hpack::Encoder::encode(const HeaderList& headers, std::string& out) {
+  if (pendingSizeUpdate_) {
+    encodeInteger(table_.maxSize(), 5, 0x20, out);
+    pendingSizeUpdate_ = false;
+  }
+
+  for (auto& header : headers) {
+    size_t exact = 0, nameOnly = 0;
+    for (size_t i = 0; i < STATIC_SIZE && exact == 0; ++i) {
+      if (STATIC_TABLE[i].first != header.first) continue;
+      if (nameOnly == 0) nameOnly = i + 1;
+      if (STATIC_TABLE[i].second == header.second) exact = i + 1;
+    }
+    for (size_t i = 0; i < table_.count() && exact == 0; ++i) {
+      auto& entry = table_.get(i);
+      if (entry.first != header.first) continue;
+      if (nameOnly == 0) nameOnly = STATIC_SIZE + i + 1;
+      if (entry.second == header.second) exact = STATIC_SIZE + i + 1;
+    }
+
+    if (exact > 0) {
+      encodeInteger(exact, 7, 0x80, out);
+      continue;
+    }
+
+    bool indexing = std::none_of(std::begin(NOT_INDEXED), std::end(NOT_INDEXED),
+                                 [&](const char* name) { return header.first == name; });
+    if (indexing) {
+      encodeInteger(nameOnly, 6, 0x40, out);
+    } else {
+      encodeInteger(nameOnly, 4, 0x00, out);
+    }
+    if (nameOnly == 0) encodeString(header.first, out);
+    encodeString(header.second, out);
+    if (indexing) table_.add(header.first, header.second);
+  }
+}
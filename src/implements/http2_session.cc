@@ -0,0 +1,571 @@
+#include "include/http2_session.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+enum FrameType : uint8_t {
+  DATA = 0x0,
+  HEADERS = 0x1,
+  PRIORITY = 0x2,
+  RST_STREAM = 0x3,
+  SETTINGS = 0x4,
+  PUSH_PROMISE = 0x5,
+  PING = 0x6,
+  GOAWAY = 0x7,
+  WINDOW_UPDATE = 0x8,
+  CONTINUATION = 0x9,
+};
+
+enum Flag : uint8_t {
+  END_STREAM = 0x1,
+  ACK = 0x1,
+  END_HEADERS = 0x4,
+  PADDED = 0x8,
+  PRIORITY_FLAG = 0x20,
+};
+
+enum ErrorCode : uint32_t {
+  NO_ERROR = 0x0,
+  PROTOCOL_ERROR = 0x1,
+  FLOW_CONTROL_ERROR = 0x3,
+  STREAM_CLOSED = 0x5,
+  FRAME_SIZE_ERROR = 0x6,
+  REFUSED_STREAM = 0x7,
+  COMPRESSION_ERROR = 0x9,
+  ENHANCE_YOUR_CALM = 0xb,
+};
+
+enum Setting : uint16_t {
+  HEADER_TABLE_SIZE = 0x1,
+  ENABLE_PUSH = 0x2,
+  MAX_CONCURRENT_STREAMS = 0x3,
+  INITIAL_WINDOW_SIZE = 0x4,
+  MAX_FRAME_SIZE = 0x5,
+  MAX_HEADER_LIST_SIZE = 0x6,
+};
+
+const size_t FRAME_HEADER_SIZE = 9;
+const uint32_t DEFAULT_FRAME_SIZE = 16384;
+const uint32_t MAX_FRAME_SIZE_LIMIT = 16777215;
+const int64_t DEFAULT_WINDOW = 65535;
+const int64_t MAX_WINDOW = 2147483647;
+
+// Announced in our SETTINGS, streams over it are refused.
+const uint32_t MAX_STREAMS = 100;
+const uint32_t MAX_HEADER_LIST = 65536;
+
+// Largest encoded header block, HEADERS and its CONTINUATIONs. Every decoded field counts
+// 32 bytes more than its strings, so a block within the list size is much smaller than this,
+// the slack is for Huffman codes longer than the octets they encode.
+const size_t MAX_HEADER_BLOCK = 2 * MAX_HEADER_LIST;
+
+// Frames queued for a peer which doesn't read, PING and SETTINGS acks or RST_STREAMs.
+const size_t MAX_CONTROL_FRAMES = 1024;
+
+// Our dynamic table for the responses, even if the client allows a larger one.
+const uint32_t ENCODER_TABLE_LIMIT = 4096;
+
+uint32_t read32(const uint8_t* p) {
+  return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+void write32(std::string& out, uint32_t value) {
+  out.push_back(static_cast<char>(value >> 24));
+  out.push_back(static_cast<char>(value >> 16));
+  out.push_back(static_cast<char>(value >> 8));
+  out.push_back(static_cast<char>(value));
+}
+
+void frameHeader(std::string& out, uint32_t length, uint8_t type, uint8_t flags,
+                 uint32_t streamId) {
+  out.push_back(static_cast<char>(length >> 16));
+  out.push_back(static_cast<char>(length >> 8));
+  out.push_back(static_cast<char>(length));
+  out.push_back(static_cast<char>(type));
+  out.push_back(static_cast<char>(flags));
+  write32(out, streamId & 0x7fffffff);
+}
+
+void setting(std::string& out, uint16_t id, uint32_t value) {
+  out.push_back(static_cast<char>(id >> 8));
+  out.push_back(static_cast<char>(id));
+  write32(out, value);
+}
+
+bool base64UrlDecode(const std::string& in, std::string& out) {
+  uint32_t buffer = 0;
+  int bits = 0;
+  for (char c : in) {
+    int value;
+    if (c >= 'A' && c <= 'Z') {
+      value = c - 'A';
+    } else if (c >= 'a' && c <= 'z') {
+      value = c - 'a' + 26;
+    } else if (c >= '0' && c <= '9') {
+      value = c - '0' + 52;
+    } else if (c == '-' || c == '+') {
+      value = 62;
+    } else if (c == '_' || c == '/') {
+      value = 63;
+    } else if (c == '=') {
+      break;
+    } else {
+      return false;
+    }
+    buffer = (buffer << 6) | value;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out.push_back(static_cast<char>(buffer >> bits));
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+const char Http2Session::PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+const size_t Http2Session::PREFACE_SIZE;
+
+Http2Session::Http2Session(Handler handler)
+    : handler_(std::move(handler)),
+      decoder_(4096, MAX_HEADER_LIST),
+      encoder_(ENCODER_TABLE_LIMIT),
+      prefaceReceived_(false),
+      continuationStream_(0),
+      continuationEndStream_(false),
+      connectionWindow_(DEFAULT_WINDOW),
+      peerInitialWindow_(DEFAULT_WINDOW),
+      peerMaxFrameSize_(DEFAULT_FRAME_SIZE),
+      lastStreamId_(0),
+      goaway_(false) {
+  std::string payload;
+  setting(payload, MAX_CONCURRENT_STREAMS, MAX_STREAMS);
+  setting(payload, MAX_HEADER_LIST_SIZE, MAX_HEADER_LIST);
+  frame_(SETTINGS, 0, 0, payload);
+}
+
+bool Http2Session::upgrade(const HttpUtils::HttpRequest& request, const std::string& settings) {
+  std::string payload;
+  if (!base64UrlDecode(settings, payload) || !onSettings_(
+          reinterpret_cast<const uint8_t*>(payload.data()), payload.size())) {
+    return false;
+  }
+  // the settings of the upgrade request are acknowledged implicitly, RFC 7540 section 3.2.1
+  control_.pop_back();
+
+  lastStreamId_ = 1;
+  auto& stream = streams_[1];
+  stream.request = request;
+  stream.sendWindow = peerInitialWindow_;
+  stream.remoteClosed = true;
+  respond_(1, stream);
+  return true;
+}
+
+bool Http2Session::feed(const char* data, size_t size) {
+  if (goaway_) return false;
+  input_.append(data, size);
+
+  if (!prefaceReceived_) {
+    if (input_.size() < PREFACE_SIZE) {
+      return std::memcmp(input_.data(), PREFACE, input_.size()) == 0 ||
+             connectionError_(PROTOCOL_ERROR);
+    }
+    if (std::memcmp(input_.data(), PREFACE, PREFACE_SIZE) != 0) {
+      return connectionError_(PROTOCOL_ERROR);
+    }
+    prefaceReceived_ = true;
+    input_.erase(0, PREFACE_SIZE);
+  }
+
+  size_t pos = 0;
+  auto bytes = reinterpret_cast<const uint8_t*>(input_.data());
+  while (input_.size() - pos >= FRAME_HEADER_SIZE) {
+    auto header = bytes + pos;
+    uint32_t length = (uint32_t(header[0]) << 16) | (uint32_t(header[1]) << 8) | header[2];
+    if (length > DEFAULT_FRAME_SIZE) return connectionError_(FRAME_SIZE_ERROR);
+    if (input_.size() - pos < FRAME_HEADER_SIZE + length) break;
+
+    auto type = header[3];
+    auto flags = header[4];
+    auto streamId = read32(header + 5) & 0x7fffffff;
+    if (!onFrame_(type, flags, streamId, header + FRAME_HEADER_SIZE, length)) return false;
+    pos += FRAME_HEADER_SIZE + length;
+  }
+  input_.erase(0, pos);
+  return true;
+}
+
+size_t Http2Session::collect(std::vector<boost::asio::const_buffer>& buffers, size_t limit) {
+  size_t total = 0;
+  auto push = [&](Chunk&& chunk) {
+    inflight_.push_back(std::move(chunk));
+    auto& back = inflight_.back();
+    buffers.emplace_back(back.bytes.data(), back.bytes.size());
+    if (back.size > 0) buffers.emplace_back(back.data, back.size);
+    total += back.bytes.size() + back.size;
+  };
+
+  while (!control_.empty()) {
+    push(std::move(control_.front()));
+    control_.pop_front();
+  }
+
+  while (total < limit && !ready_.empty() && connectionWindow_ > 0) {
+    auto streamId = ready_.front();
+    ready_.pop_front();
+    auto it = streams_.find(streamId);
+    if (it == streams_.end()) continue;
+
+    auto& stream = it->second;
+    stream.queued = false;
+    auto& body = stream.response.body;
+    auto remaining = body.size() - stream.sent;
+    int64_t size = std::min<int64_t>(
+        {static_cast<int64_t>(remaining), peerMaxFrameSize_, stream.sendWindow, connectionWindow_});
+    if (size <= 0) continue;
+
+    bool last = static_cast<size_t>(size) == remaining;
+    Chunk chunk;
+    frameHeader(chunk.bytes, size, DATA, last ? END_STREAM : 0, streamId);
+    chunk.body = body;
+    chunk.data = body.data() + stream.sent;
+    chunk.size = size;
+    push(std::move(chunk));
+
+    stream.sent += size;
+    stream.sendWindow -= size;
+    connectionWindow_ -= size;
+    if (last) {
+      streams_.erase(it);
+    } else {
+      schedule_(streamId, stream);
+    }
+  }
+  return total;
+}
+
+void Http2Session::consumed() { inflight_.clear(); }
+
+bool Http2Session::closed() const {
+  if (!goaway_ || !control_.empty()) return false;
+  // after GOAWAY the streams already started are still finished
+  return std::none_of(streams_.begin(), streams_.end(),
+                      [](const std::pair<const uint32_t, Stream>& entry) {
+                        return entry.second.responding &&
+                               entry.second.sent < entry.second.response.body.size();
+                      });
+}
+
+void Http2Session::frame_(uint8_t type, uint8_t flags, uint32_t streamId,
+                          const std::string& payload) {
+  Chunk chunk;
+  frameHeader(chunk.bytes, payload.size(), type, flags, streamId);
+  chunk.bytes += payload;
+  control_.push_back(std::move(chunk));
+}
+
+bool Http2Session::connectionError_(uint32_t code) {
+  std::string payload;
+  write32(payload, lastStreamId_);
+  write32(payload, code);
+  frame_(GOAWAY, 0, 0, payload);
+  goaway_ = true;
+  streams_.clear();
+  ready_.clear();
+  return false;
+}
+
+void Http2Session::resetStream_(uint32_t streamId, uint32_t code) {
+  std::string payload;
+  write32(payload, code);
+  frame_(RST_STREAM, 0, streamId, payload);
+  streams_.erase(streamId);
+}
+
+bool Http2Session::onFrame_(uint8_t type, uint8_t flags, uint32_t streamId,
+                            const uint8_t* payload, uint32_t length) {
+  // a header block must not be interleaved with any other frame
+  if (continuationStream_ != 0 && (type != CONTINUATION || streamId != continuationStream_)) {
+    return connectionError_(PROTOCOL_ERROR);
+  }
+  // a peer sending frames which only make us answer, without reading the answers
+  if (control_.size() >= MAX_CONTROL_FRAMES) return connectionError_(ENHANCE_YOUR_CALM);
+
+  switch (type) {
+    case DATA:
+      return onData_(flags, streamId, payload, length);
+    case HEADERS:
+      return onHeaders_(flags, streamId, payload, length);
+    case PRIORITY:
+      if (streamId == 0) return connectionError_(PROTOCOL_ERROR);
+      if (length != 5) resetStream_(streamId, FRAME_SIZE_ERROR);
+      return true;
+    case RST_STREAM:
+      if (streamId == 0 || streamId > lastStreamId_) return connectionError_(PROTOCOL_ERROR);
+      if (length != 4) return connectionError_(FRAME_SIZE_ERROR);
+      streams_.erase(streamId);
+      return true;
+    case SETTINGS:
+      if (streamId != 0) return connectionError_(PROTOCOL_ERROR);
+      if (flags & ACK) return length == 0 || connectionError_(FRAME_SIZE_ERROR);
+      return onSettings_(payload, length);
+    case PUSH_PROMISE:
+      return connectionError_(PROTOCOL_ERROR);
+    case PING:
+      if (streamId != 0) return connectionError_(PROTOCOL_ERROR);
+      if (length != 8) return connectionError_(FRAME_SIZE_ERROR);
+      if (!(flags & ACK)) {
+        frame_(PING, ACK, 0, std::string(reinterpret_cast<const char*>(payload), length));
+      }
+      return true;
+    case GOAWAY:
+      if (streamId != 0) return connectionError_(PROTOCOL_ERROR);
+      // no new stream will come, finish the streams which are being sent
+      goaway_ = true;
+      return true;
+    case WINDOW_UPDATE:
+      return onWindowUpdate_(streamId, payload, length);
+    case CONTINUATION:
+      if (continuationStream_ == 0) return connectionError_(PROTOCOL_ERROR);
+      // CONTINUATION without END_HEADERS must not grow the block forever
+      if (headerBlock_.size() + length > MAX_HEADER_BLOCK) {
+        return connectionError_(ENHANCE_YOUR_CALM);
+      }
+      headerBlock_.append(reinterpret_cast<const char*>(payload), length);
+      if (flags & END_HEADERS) {
+        continuationStream_ = 0;
+        return onHeaderBlock_(streamId, continuationEndStream_);
+      }
+      return true;
+    default:
+      // unknown frame types are ignored, RFC 7540 section 4.1
+      return true;
+  }
+}
+
+bool Http2Session::onHeaders_(uint8_t flags, uint32_t streamId, const uint8_t* payload,
+                              uint32_t length) {
+  if (streamId == 0) return connectionError_(PROTOCOL_ERROR);
+
+  uint32_t begin = 0, end = length;
+  if (flags & PADDED) {
+    if (length < 1 || payload[0] >= length) return connectionError_(PROTOCOL_ERROR);
+    begin = 1;
+    end -= payload[0];
+  }
+  if (flags & PRIORITY_FLAG) {
+    if (end - begin < 5) return connectionError_(FRAME_SIZE_ERROR);
+    begin += 5;
+  }
+
+  if (end - begin > MAX_HEADER_BLOCK) return connectionError_(ENHANCE_YOUR_CALM);
+  headerBlock_.assign(reinterpret_cast<const char*>(payload + begin), end - begin);
+  if (!(flags & END_HEADERS)) {
+    continuationStream_ = streamId;
+    continuationEndStream_ = flags & END_STREAM;
+    return true;
+  }
+  return onHeaderBlock_(streamId, flags & END_STREAM);
+}
+
+bool Http2Session::onHeaderBlock_(uint32_t streamId, bool endStream) {
+  // decode even if the stream is refused, the dynamic table must stay in sync
+  Hpack::HeaderList headers;
+  if (!decoder_.decode(reinterpret_cast<const uint8_t*>(headerBlock_.data()),
+                       headerBlock_.size(), headers)) {
+    return connectionError_(COMPRESSION_ERROR);
+  }
+  headerBlock_.clear();
+
+  auto it = streams_.find(streamId);
+  if (it != streams_.end()) {
+    // trailers, only the end of the request matters
+    auto& stream = it->second;
+    if (stream.remoteClosed) {
+      resetStream_(streamId, STREAM_CLOSED);
+    } else if (endStream) {
+      stream.remoteClosed = true;
+      respond_(streamId, stream);
+    }
+    return true;
+  }
+
+  if (streamId % 2 == 0 || streamId <= lastStreamId_) return connectionError_(PROTOCOL_ERROR);
+  lastStreamId_ = streamId;
+  if (goaway_) return true;
+  if (streams_.size() >= MAX_STREAMS) {
+    resetStream_(streamId, REFUSED_STREAM);
+    return true;
+  }
+
+  HttpUtils::HttpRequest request;
+  for (auto& header : headers) {
+    if (header.first == ":method") {
+      request.method = header.second;
+    } else if (header.first == ":path") {
+      request.pathname = header.second.substr(0, header.second.find('?'));
+    } else if (header.first == ":authority") {
+      request.headers["host"] = header.second;
+    } else if (header.first[0] != ':') {
+      request.headers[header.first] = header.second;
+    }
+  }
+  if (request.method.empty() || request.pathname.empty()) {
+    std::string payload;
+    write32(payload, PROTOCOL_ERROR);
+    frame_(RST_STREAM, 0, streamId, payload);
+    return true;
+  }
+
+  auto& stream = streams_[streamId];
+  stream.request = std::move(request);
+  stream.sendWindow = peerInitialWindow_;
+  stream.remoteClosed = endStream;
+  if (endStream) respond_(streamId, stream);
+  return true;
+}
+
+bool Http2Session::onData_(uint8_t flags, uint32_t streamId, const uint8_t* payload,
+                           uint32_t length) {
+  if (streamId == 0) return connectionError_(PROTOCOL_ERROR);
+  if (flags & PADDED && (length < 1 || payload[0] >= length)) {
+    return connectionError_(PROTOCOL_ERROR);
+  }
+
+  // the body is dropped, give the window back at once
+  if (length > 0) {
+    std::string increment;
+    write32(increment, length);
+    frame_(WINDOW_UPDATE, 0, 0, increment);
+  }
+
+  auto it = streams_.find(streamId);
+  if (it == streams_.end() || it->second.remoteClosed) {
+    if (streamId > lastStreamId_) return connectionError_(PROTOCOL_ERROR);
+    resetStream_(streamId, STREAM_CLOSED);
+    return true;
+  }
+
+  auto& stream = it->second;
+  if (flags & END_STREAM) {
+    stream.remoteClosed = true;
+    respond_(streamId, stream);
+  } else if (length > 0) {
+    std::string increment;
+    write32(increment, length);
+    frame_(WINDOW_UPDATE, 0, streamId, increment);
+  }
+  return true;
+}
+
+bool Http2Session::onSettings_(const uint8_t* payload, uint32_t length) {
+  if (length % 6 != 0) return connectionError_(FRAME_SIZE_ERROR);
+
+  for (uint32_t pos = 0; pos < length; pos += 6) {
+    uint16_t id = (uint16_t(payload[pos]) << 8) | payload[pos + 1];
+    uint32_t value = read32(payload + pos + 2);
+    switch (id) {
+      case HEADER_TABLE_SIZE:
+        encoder_.setMaxTableSize(std::min(value, ENCODER_TABLE_LIMIT));
+        break;
+      case ENABLE_PUSH:
+        if (value > 1) return connectionError_(PROTOCOL_ERROR);
+        break;
+      case INITIAL_WINDOW_SIZE: {
+        if (value > MAX_WINDOW) return connectionError_(FLOW_CONTROL_ERROR);
+        auto delta = static_cast<int64_t>(value) - peerInitialWindow_;
+        peerInitialWindow_ = value;
+        for (auto& entry : streams_) {
+          entry.second.sendWindow += delta;
+          if (entry.second.sendWindow > MAX_WINDOW) return connectionError_(FLOW_CONTROL_ERROR);
+          schedule_(entry.first, entry.second);
+        }
+        break;
+      }
+      case MAX_FRAME_SIZE:
+        if (value < DEFAULT_FRAME_SIZE || value > MAX_FRAME_SIZE_LIMIT) {
+          return connectionError_(PROTOCOL_ERROR);
+        }
+        peerMaxFrameSize_ = value;
+        break;
+      default:
+        // MAX_CONCURRENT_STREAMS and MAX_HEADER_LIST_SIZE only limit what we never send
+        break;
+    }
+  }
+  frame_(SETTINGS, ACK, 0, std::string());
+  return true;
+}
+
+bool Http2Session::onWindowUpdate_(uint32_t streamId, const uint8_t* payload, uint32_t length) {
+  if (length != 4) return connectionError_(FRAME_SIZE_ERROR);
+  auto increment = read32(payload) & 0x7fffffff;
+
+  if (streamId == 0) {
+    if (increment == 0) return connectionError_(PROTOCOL_ERROR);
+    connectionWindow_ += increment;
+    if (connectionWindow_ > MAX_WINDOW) return connectionError_(FLOW_CONTROL_ERROR);
+    return true;
+  }
+
+  auto it = streams_.find(streamId);
+  if (it == streams_.end()) return true;
+  if (increment == 0) {
+    resetStream_(streamId, PROTOCOL_ERROR);
+    return true;
+  }
+  it->second.sendWindow += increment;
+  if (it->second.sendWindow > MAX_WINDOW) {
+    resetStream_(streamId, FLOW_CONTROL_ERROR);
+    return true;
+  }
+  schedule_(streamId, it->second);
+  return true;
+}
+
+void Http2Session::respond_(uint32_t streamId, Stream& stream) {
+  stream.response = handler_(stream.request);
+  stream.responding = true;
+  auto& response = stream.response.response;
+  if (stream.request.method == "HEAD") stream.response.body = CacheContent();
+
+  Hpack::HeaderList headers;
+  headers.emplace_back(":status", std::to_string(response.state_));
+  headers.emplace_back("content-type", response.contentType_);
+  headers.emplace_back("content-length", std::to_string(response.contentLength_));
+  for (auto& header : response.headers_) headers.push_back(header);
+
+  std::string block;
+  encoder_.encode(headers, block);
+  bool endStream = stream.response.body.size() == 0;
+
+  // split the block into HEADERS and CONTINUATION frames no larger than the peer allows
+  size_t pos = 0;
+  do {
+    auto size = std::min<size_t>(block.size() - pos, peerMaxFrameSize_);
+    bool lastFragment = pos + size == block.size();
+    uint8_t flags = lastFragment ? END_HEADERS : 0;
+    if (pos == 0 && endStream) flags |= END_STREAM;
+    frame_(pos == 0 ? HEADERS : CONTINUATION, flags, streamId, block.substr(pos, size));
+    pos += size;
+  } while (pos < block.size());
+
+  if (endStream) {
+    streams_.erase(streamId);
+  } else {
+    schedule_(streamId, stream);
+  }
+}
+
+void Http2Session::schedule_(uint32_t streamId, Stream& stream) {
+  if (stream.queued || !stream.responding || stream.sendWindow <= 0 ||
+      stream.sent >= stream.response.body.size()) {
+    return;
+  }
+  stream.queued = true;
+  ready_.push_back(streamId);
+}
@@ -1,8 +1,30 @@
 #include "include/http_server.hpp"
 
+namespace {
+// At most this many paths are saved and warmed.
+const size_t WARM_UP_LIMIT = 1000;
+
+// Warm-up jobs mostly wait for the disk, so there are more of them than cores.
+const uint16_t WARM_UP_THREADS = 16;
+
+// Listen after this long even if the warm-up fraction isn't reached.
+const std::chrono::seconds WARM_UP_TIMEOUT(30);
+}  // namespace
+
 HttpServer::HttpServer(std::string fileRoot, ushort port)
+    : HttpServer(fileRoot, port, std::make_shared<ServerContext>()) {}
+
+HttpServer::HttpServer(std::string fileRoot, ushort port, std::shared_ptr<ServerContext> context)
     : rootpath_(fileRoot),
-      acceptor_(io_context_, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port)) {
+      acceptor_(io_context_),
+      context_(std::move(context)),
+      recordTimer_(io_context_) {
+  boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::tcp::v4(), port);
+  acceptor_.open(endpoint.protocol());
+  acceptor_.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+  // the port is taken now, but connections are refused until start() listens
+  acceptor_.bind(endpoint);
+
   namespace fs = boost::filesystem;
   if (!fs::exists(rootpath_) && !fs::is_directory(rootpath_)) {
     throw std::runtime_error(rootpath_ + " isn't directory.\n");
@@ -12,10 +34,54 @@ HttpServer::HttpServer(std::string fileRoot, ushort port)
   }
 }
 
-void HttpServer::start() { accept_(); }
+void HttpServer::warmUp(const std::string& listFile, double fraction,
+                        std::chrono::seconds recordPeriod) {
+  warmList_ = listFile;
+  warmFraction_ = fraction;
+  recordPeriod_ = recordPeriod;
+  context_->popularity = std::make_shared<Popularity>();
+  warmer_ = std::make_unique<CacheWarmer>(context_, Popularity::load(listFile, WARM_UP_LIMIT));
+  warmPool_ = std::make_unique<ThreadPool>(WARM_UP_THREADS);
+}
+
+void HttpServer::start() {
+  if (warmer_) {
+    auto deadline = ThreadPool::Clock::now() + WARM_UP_TIMEOUT;
+    warmer_->start(*warmPool_, deadline);
+    warmer_->wait(warmFraction_, deadline);
+    std::cout << "Warmed " << warmer_->warmed() << " of " << warmer_->total() << " files\n";
+    if (recordPeriod_.count() > 0) record_();
+  }
+  acceptor_.listen();
+  accept_();
+  io_context_.run();
+}
+
+void HttpServer::record_() {
+  recordTimer_.expires_after(recordPeriod_);
+  recordTimer_.async_wait([this](boost::system::error_code ec) {
+    if (ec) return;
+    auto popularity = context_->popularity;
+    auto file = warmList_;
+    // behind the warm-up jobs still running, it is not urgent
+    warmPool_->submit(ThreadPool::Priority::LOW, [popularity, file] {
+      if (!popularity->save(file, WARM_UP_LIMIT)) std::cerr << "Can't save " << file << "\n";
+    });
+    record_();
+  });
+}
 
 void HttpServer::accept_() {
-  auto conn = std::make_shared<Connection>(io_context_);
+  if (context_->coroutines) {
+    auto conn = std::make_shared<CoroConnection>(io_context_, context_);
+    acceptor_.async_accept(conn->socket(), [this, conn](boost::system::error_code ec) {
+      if (!ec) conn->start();
+      accept_();
+    });
+    return;
+  }
+
+  auto conn = std::make_shared<Connection>(io_context_, context_);
   acceptor_.async_accept(conn->socket(), [this, conn](boost::system::error_code ec) {
     if (!ec) {
       std::cout << "Connection!\n";
@@ -23,6 +89,4 @@ void HttpServer::accept_() {
     }
     accept_();
   });
-
-  io_context_.run();
 }
@@ -1,5 +1,8 @@
 #include "include/http_utils.hpp"
 
+#include <algorithm>
+#include <cctype>
+
 HttpUtils::HttpRequest::HttpRequest(std::string& request_str) {
   std::stringstream ss(request_str);
   std::string result_temp;
@@ -7,6 +10,8 @@ HttpUtils::HttpRequest::HttpRequest(std::string& request_str) {
   /* Iterate Http request string */
   bool pathResolved = false, setMethod = false, setPath = false;
   while (std::getline(ss, result_temp, '\n')) {
+    if (!result_temp.empty() && result_temp.back() == '\r') result_temp.pop_back();
+
     /* First, process path information */
     if (!pathResolved) {
       std::string::size_type strBegin = 0;
@@ -36,6 +41,7 @@ HttpUtils::HttpRequest::HttpRequest(std::string& request_str) {
 
     /*Second, deal with the header*/
     auto delim = result_temp.find(": ");
+    if (delim == std::string::npos) continue;
     auto headerKey = result_temp.substr(0, delim);
     auto content = result_temp.substr(delim + 2);
     headers[headerKey] = content;
@@ -43,6 +49,21 @@ HttpUtils::HttpRequest::HttpRequest(std::string& request_str) {
   rawData = request_str;
 }
 
+HttpUtils::HttpRequest::HttpRequest() {}
+
+std::string HttpUtils::HttpRequest::header(const std::string& name) const {
+  for (auto& header : headers) {
+    if (header.first.size() == name.size() &&
+        std::equal(name.begin(), name.end(), header.first.begin(),
+                   [](char a, char b) { return tolower(a) == tolower(b); })) {
+      return header.second;
+    }
+  }
+  return std::string();
+}
+
+HttpUtils::HttpResponse::HttpResponse() : state_(200) {}
+
 HttpUtils::HttpResponse::HttpResponse(const std::string& requestFile) {
   namespace fs = boost::filesystem;
   if (fs::exists(requestFile)) {
@@ -66,19 +87,37 @@ HttpUtils::HttpResponse& HttpUtils::HttpResponse::setMessage(std::string message
 
 HttpUtils::HttpResponse& HttpUtils::HttpResponse::setContent(std::string& content) {
   content_ = content;
+  contentLength_ = content_.size();
+  return *this;
+}
+
+HttpUtils::HttpResponse& HttpUtils::HttpResponse::setContentLength(size_t contentLength) {
+  contentLength_ = contentLength;
+  return *this;
+}
+
+HttpUtils::HttpResponse& HttpUtils::HttpResponse::setHeader(const std::string& name,
+                                                            const std::string& value) {
+  headers_[name] = value;
+  return *this;
+}
+
+HttpUtils::HttpResponse& HttpUtils::HttpResponse::setContentType(const std::string& contentType) {
+  contentType_ = contentType;
   return *this;
 }
 
-std::string HttpUtils::HttpResponse::stringify() {
+std::string HttpUtils::HttpResponse::stringify() { return stringifyHeader() + content_; }
+
+std::string HttpUtils::HttpResponse::stringifyHeader() const {
   std::stringstream resContent;
-  resContent << "HTTP/1.1 " << state_ << " " << message_ << "\r\n";
-  if(state_ == 200) {
-    resContent << "content-type: text/plain\r\n" 
-               << "content-length: " << content_.size() << "\r\n"
-               << "\r\n" << content_;
-  } else {
-    resContent << "content-type: text/plain\r\n";
+  resContent << "HTTP/1.1 " << state_ << " " << message_ << "\r\n"
+             << "content-type: " << contentType_ << "\r\n"
+             << "content-length: " << contentLength_ << "\r\n";
+  for (auto& header : headers_) {
+    resContent << header.first << ": " << header.second << "\r\n";
   }
+  resContent << "\r\n";
 
   return resContent.str();
-};
+}
@@ -0,0 +1,229 @@
+#include "include/mime_types.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+struct MimeEntry {
+  const char* extension;
+  const char* type;
+};
+
+constexpr MimeEntry BUILTIN_TYPES[] = {
+    {"html", "text/html"},
+    {"htm", "text/html"},
+    {"css", "text/css"},
+    {"js", "text/javascript"},
+    {"mjs", "text/javascript"},
+    {"json", "application/json"},
+    {"jsonld", "application/ld+json"},
+    {"map", "application/json"},
+    {"webmanifest", "application/manifest+json"},
+    {"xml", "application/xml"},
+    {"rss", "application/rss+xml"},
+    {"atom", "application/atom+xml"},
+    {"txt", "text/plain"},
+    {"csv", "text/csv"},
+    {"md", "text/markdown"},
+    {"yaml", "application/yaml"},
+    {"yml", "application/yaml"},
+    {"wasm", "application/wasm"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"avif", "image/avif"},
+    {"ico", "image/x-icon"},
+    {"bmp", "image/bmp"},
+    {"tif", "image/tiff"},
+    {"tiff", "image/tiff"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"otf", "font/otf"},
+    {"eot", "application/vnd.ms-fontobject"},
+    {"pdf", "application/pdf"},
+    {"zip", "application/zip"},
+    {"gz", "application/gzip"},
+    {"tgz", "application/gzip"},
+    {"tar", "application/x-tar"},
+    {"bz2", "application/x-bzip2"},
+    {"xz", "application/x-xz"},
+    {"7z", "application/x-7z-compressed"},
+    {"jar", "application/java-archive"},
+    {"apk", "application/vnd.android.package-archive"},
+    {"deb", "application/vnd.debian.binary-package"},
+    {"iso", "application/x-iso9660-image"},
+    {"bin", "application/octet-stream"},
+    {"exe", "application/octet-stream"},
+    {"sh", "application/x-sh"},
+    {"rtf", "application/rtf"},
+    {"doc", "application/msword"},
+    {"docx", "application/vnd.openxmlformats-officedocument.wordprocessingml.document"},
+    {"xls", "application/vnd.ms-excel"},
+    {"xlsx", "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet"},
+    {"ppt", "application/vnd.ms-powerpoint"},
+    {"pptx", "application/vnd.openxmlformats-officedocument.presentationml.presentation"},
+    {"mp3", "audio/mpeg"},
+    {"m4a", "audio/mp4"},
+    {"ogg", "audio/ogg"},
+    {"oga", "audio/ogg"},
+    {"wav", "audio/wav"},
+    {"flac", "audio/flac"},
+    {"mp4", "video/mp4"},
+    {"ogv", "video/ogg"},
+    {"webm", "video/webm"},
+    {"mov", "video/quicktime"},
+    {"avi", "video/x-msvideo"},
+    {"mkv", "video/x-matroska"},
+    {"mpeg", "video/mpeg"},
+    {"mpg", "video/mpeg"},
+};
+
+constexpr size_t BUILTIN_SIZE = sizeof(BUILTIN_TYPES) / sizeof(BUILTIN_TYPES[0]);
+
+// Power of two, about 8 slots per entry keeps the seed search short.
+constexpr size_t TABLE_SIZE = 512;
+
+// Give up the seed search after this many tries, see static_assert below.
+constexpr uint32_t MAX_SEED = 4096;
+
+static_assert(BUILTIN_SIZE < INT8_MAX, "slot index is stored in int8_t");
+
+constexpr char toLower(char c) { return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c; }
+
+constexpr size_t length(const char* s) {
+  size_t n = 0;
+  while (s[n]) ++n;
+  return n;
+}
+
+// FNV-1a of the lower case extension, mixed with seed.
+constexpr uint32_t hashExtension(const char* s, size_t n, uint32_t seed) {
+  uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+  for (size_t i = 0; i < n; ++i) {
+    hash ^= static_cast<unsigned char>(toLower(s[i]));
+    hash *= 16777619u;
+  }
+  return hash ^ (hash >> 15);
+}
+
+struct PerfectTable {
+  uint32_t seed;
+  int8_t slots[TABLE_SIZE];
+};
+
+// Try seeds until every built-in extension falls into its own slot.
+constexpr PerfectTable buildTable() {
+  PerfectTable table{MAX_SEED, {}};
+  for (uint32_t seed = 0; seed < MAX_SEED; ++seed) {
+    for (size_t i = 0; i < TABLE_SIZE; ++i) table.slots[i] = -1;
+
+    bool collided = false;
+    for (size_t i = 0; i < BUILTIN_SIZE && !collided; ++i) {
+      auto ext = BUILTIN_TYPES[i].extension;
+      auto slot = hashExtension(ext, length(ext), seed) & (TABLE_SIZE - 1);
+      if (table.slots[slot] != -1) {
+        collided = true;
+      } else {
+        table.slots[slot] = static_cast<int8_t>(i);
+      }
+    }
+
+    if (!collided) {
+      table.seed = seed;
+      return table;
+    }
+  }
+  return table;
+}
+
+constexpr PerfectTable TABLE = buildTable();
+
+static_assert(TABLE.seed != MAX_SEED, "no perfect hash seed for the built-in mime types");
+
+// Return the extension of path without the dot, or an empty range if there is no extension.
+void extensionOf(const std::string& path, const char*& begin, size_t& size) {
+  auto dot = path.find_last_of("./");
+  if (dot == std::string::npos || path[dot] != '.') {
+    begin = nullptr;
+    size = 0;
+    return;
+  }
+  begin = path.c_str() + dot + 1;
+  size = path.size() - dot - 1;
+}
+
+}  // namespace
+
+const char* const MimeTypes::DEFAULT_TYPE = "application/octet-stream";
+
+const char* MimeTypes::lookupBuiltin(const std::string& path) {
+  const char* ext;
+  size_t size;
+  extensionOf(path, ext, size);
+  if (size == 0) return DEFAULT_TYPE;
+
+  auto index = TABLE.slots[hashExtension(ext, size, TABLE.seed) & (TABLE_SIZE - 1)];
+  if (index < 0) return DEFAULT_TYPE;
+
+  auto candidate = BUILTIN_TYPES[index].extension;
+  for (size_t i = 0; i < size; ++i) {
+    if (candidate[i] == '\0' || candidate[i] != toLower(ext[i])) return DEFAULT_TYPE;
+  }
+  return candidate[size] == '\0' ? BUILTIN_TYPES[index].type : DEFAULT_TYPE;
+}
+
+const char* MimeTypes::lookup(const std::string& path) const {
+  if (!overrides_.empty()) {
+    const char* ext;
+    size_t size;
+    extensionOf(path, ext, size);
+    if (size > 0) {
+      std::string key(ext, size);
+      for (auto& c : key) c = toLower(c);
+      auto it = overrides_.find(key);
+      if (it != overrides_.end()) return it->second.c_str();
+    }
+  }
+  return lookupBuiltin(path);
+}
+
+bool MimeTypes::load(const std::string& filename) {
+  std::ifstream file(filename);
+  if (!file) return false;
+
+  std::string line;
+  while (std::getline(file, line)) {
+    auto comment = line.find('#');
+    if (comment != std::string::npos) line.erase(comment);
+
+    std::stringstream ss(line);
+    std::string type, token;
+    if (!(ss >> type)) continue;
+    if (type.back() == ';') type.pop_back();
+    if (type.empty()) continue;
+    std::vector<std::string> extensions;
+    while (ss >> token) {
+      if (token.front() == ';') token.erase(0, 1);
+      if (!token.empty() && token.back() == ';') token.pop_back();
+      if (token.empty()) continue;
+      // "type; name=value" parameters belong to the type, an extension never has '='
+      if (token.find('=') != std::string::npos) {
+        type += "; " + token;
+        continue;
+      }
+      if (token.front() == '.') token.erase(0, 1);
+      if (token.empty()) continue;
+      for (auto& c : token) c = toLower(c);
+      extensions.push_back(token);
+    }
+    for (auto& ext : extensions) overrides_[ext] = type;
+  }
+  return true;
+}
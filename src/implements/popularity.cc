@@ -0,0 +1,92 @@
+#include "include/popularity.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <utility>
+
+Popularity::Popularity(size_t shardSize) {
+  size_t size = 1;
+  while (size < shardSize) size <<= 1;
+  for (size_t i = 0; i < size; ++i) {
+    shards_.emplace_back(new Shard());
+  }
+}
+
+Popularity::Shard& Popularity::shard_(const std::string& path) const {
+  return *shards_[std::hash<std::string>()(path) & (shards_.size() - 1)];
+}
+
+void Popularity::record(const std::string& path) {
+  auto& shard = shard_(path);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.counts[path]++;
+}
+
+uint64_t Popularity::count(const std::string& path) const {
+  auto& shard = shard_(path);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.counts.find(path);
+  return it == shard.counts.end() ? 0 : it->second;
+}
+
+bool Popularity::save(const std::string& file, size_t limit) {
+  std::vector<std::pair<uint64_t, std::string>> top;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    for (auto& count : shard->counts) top.emplace_back(count.second, count.first);
+  }
+
+  // most requested first, equal counts by path so the file is stable
+  auto byCount = [](const std::pair<uint64_t, std::string>& a,
+                    const std::pair<uint64_t, std::string>& b) {
+    return a.first != b.first ? a.first > b.first : a.second < b.second;
+  };
+  auto end = top.begin() + std::min(limit, top.size());
+  std::partial_sort(top.begin(), end, top.end(), byCount);
+
+  auto tmp = file + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::trunc);
+    for (auto it = top.begin(); it != end; ++it) out << it->first << ' ' << it->second << '\n';
+    out.flush();
+    if (!out) {
+      std::remove(tmp.c_str());
+      return false;
+    }
+  }
+  // a reader never sees a half written list
+  if (std::rename(tmp.c_str(), file.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    return false;
+  }
+  // only a saved period is forgotten
+  decay_();
+  return true;
+}
+
+void Popularity::decay_() {
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    for (auto it = shard->counts.begin(); it != shard->counts.end();) {
+      // a path requested once per period keeps a count of 1
+      if ((it->second >>= 1) == 0) {
+        it = shard->counts.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+std::vector<std::string> Popularity::load(const std::string& file, size_t limit) {
+  std::vector<std::string> paths;
+  std::ifstream in(file);
+  std::string line;
+  while (paths.size() < limit && std::getline(in, line)) {
+    auto space = line.find(' ');
+    if (space == std::string::npos || space + 1 == line.size()) continue;
+    paths.push_back(line.substr(space + 1));
+  }
+  return paths;
+}
@@ -0,0 +1,112 @@
+#include "include/rate_limiter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// A shard holding more buckets than this is swept before a new bucket is inserted.
+const size_t SHARD_SWEEP_THRESHOLD = 4096;
+}  // namespace
+
+RateLimiter::RateLimiter(double rate, double burst, size_t shardSize)
+    : rate_(rate), burst_(std::max(burst, 1.0)) {
+  size_t size = 1;
+  while (size < shardSize) size <<= 1;
+  for (size_t i = 0; i < size; ++i) {
+    shards_.emplace_back(new Shard());
+  }
+}
+
+size_t RateLimiter::KeyHash::operator()(const Key& key) const {
+  // FNV-1a, the key is only 16 bytes.
+  size_t hash = 14695981039346656037ULL;
+  for (auto byte : key) {
+    hash ^= byte;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+uint32_t RateLimiter::acquire(const boost::asio::ip::address& address) {
+  return acquire(address, Clock::now());
+}
+
+uint32_t RateLimiter::acquire(const boost::asio::ip::address& address, Clock::time_point now) {
+  if (rate_ <= 0) return 0;
+
+  Key key;
+  if (address.is_v4()) {
+    key = boost::asio::ip::make_address_v6(boost::asio::ip::v4_mapped, address.to_v4()).to_bytes();
+  } else {
+    key = address.to_v6().to_bytes();
+  }
+
+  auto& shard = *shards_[KeyHash()(key) & (shards_.size() - 1)];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  auto it = shard.buckets.find(key);
+  if (it == shard.buckets.end()) {
+    if (shard.buckets.size() >= SHARD_SWEEP_THRESHOLD) sweep_(shard, now);
+    shard.buckets.emplace(key, Bucket{burst_ - 1, now});
+    return 0;
+  }
+
+  auto& bucket = it->second;
+  std::chrono::duration<double> elapsed = now - bucket.updated;
+  bucket.tokens = std::min(burst_, bucket.tokens + elapsed.count() * rate_);
+  bucket.updated = now;
+  if (bucket.tokens >= 1) {
+    bucket.tokens -= 1;
+    return 0;
+  }
+
+  return static_cast<uint32_t>(std::max(1.0, std::ceil((1 - bucket.tokens) / rate_)));
+}
+
+size_t RateLimiter::size() const {
+  size_t total = 0;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    total += shard->buckets.size();
+  }
+  return total;
+}
+
+void RateLimiter::sweep_(Shard& shard, Clock::time_point now) {
+  for (auto it = shard.buckets.begin(); it != shard.buckets.end();) {
+    std::chrono::duration<double> elapsed = now - it->second.updated;
+    if (it->second.tokens + elapsed.count() * rate_ >= burst_) {
+      it = shard.buckets.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+AdmissionController::AdmissionController(size_t maxInFlight) : max_(maxInFlight), inFlight_(0) {}
+
+AdmissionController::Ticket AdmissionController::tryEnter() {
+  auto current = inFlight_.load();
+  do {
+    if (max_ > 0 && current >= max_) return Ticket();
+  } while (!inFlight_.compare_exchange_weak(current, current + 1));
+  return Ticket(this);
+}
+
+size_t AdmissionController::inFlight() const { return inFlight_.load(); }
+
+AdmissionController::Ticket& AdmissionController::Ticket::operator=(Ticket&& other) {
+  if (this != &other) {
+    release();
+    owner_ = other.owner_;
+    other.owner_ = nullptr;
+  }
+  return *this;
+}
+
+void AdmissionController::Ticket::release() {
+  if (owner_) {
+    --owner_->inFlight_;
+    owner_ = nullptr;
+  }
+}
@@ -0,0 +1,293 @@
+#include "include/reverse_proxy.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+// Headers which only concern one connection, they are never forwarded.
+const char* const HOP_BY_HOP[] = {"connection", "keep-alive", "proxy-connection", "te", "upgrade"};
+
+using HeaderList = std::vector<std::pair<std::string, std::string>>;
+
+std::string lower(std::string value) {
+  std::transform(value.begin(), value.end(), value.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return value;
+}
+
+std::string trim(const std::string& value) {
+  auto begin = value.find_first_not_of(" \t");
+  if (begin == std::string::npos) return std::string();
+  auto end = value.find_last_not_of(" \t");
+  return value.substr(begin, end - begin + 1);
+}
+
+/* Lower case tokens of a comma separated header value */
+std::vector<std::string> tokens(const std::string& value) {
+  std::vector<std::string> result;
+  size_t begin = 0;
+  while (begin <= value.size()) {
+    auto end = value.find(',', begin);
+    if (end == std::string::npos) end = value.size();
+    auto token = lower(trim(value.substr(begin, end - begin)));
+    if (!token.empty()) result.push_back(token);
+    begin = end + 1;
+  }
+  return result;
+}
+
+/*
+ * Split a head into its first line and headers, names are lower cased.
+ * Lines folded or without a colon are rejected, so both sides agree on the framing.
+ */
+bool parseHead(const std::string& head, std::string& firstLine, HeaderList& headers) {
+  auto end = head.find("\r\n\r\n");
+  if (end == std::string::npos) return false;
+  size_t begin = 0;
+  bool first = true;
+  while (begin < end) {
+    auto lineEnd = head.find("\r\n", begin);
+    auto line = head.substr(begin, lineEnd - begin);
+    begin = lineEnd + 2;
+    if (first) {
+      firstLine = line;
+      first = false;
+      continue;
+    }
+    auto colon = line.find(':');
+    if (colon == std::string::npos || colon == 0 || line[0] == ' ' || line[0] == '\t' ||
+        line.find_first_of(" \t") < colon) {
+      return false;
+    }
+    headers.emplace_back(lower(line.substr(0, colon)), trim(line.substr(colon + 1)));
+  }
+  return !firstLine.empty();
+}
+
+/*
+ * Find the framing from Transfer-Encoding and Content-Length,
+ * return false if Content-Length is invalid or repeated with different values.
+ */
+bool bodyMode(const HeaderList& headers, bool& chunked, bool& encoded, bool& hasLength,
+              uint64_t& length) {
+  chunked = encoded = hasLength = false;
+  length = 0;
+  for (auto& header : headers) {
+    if (header.first == "transfer-encoding") {
+      auto codings = tokens(header.second);
+      encoded = encoded || !codings.empty();
+      chunked = !codings.empty() && codings.back() == "chunked";
+    } else if (header.first == "content-length") {
+      auto& value = header.second;
+      if (value.empty() || value.size() > 18 ||
+          !std::all_of(value.begin(), value.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        return false;
+      }
+      auto parsed = std::stoull(value);
+      if (hasLength && parsed != length) return false;
+      hasLength = true;
+      length = parsed;
+    }
+  }
+  return true;
+}
+
+/* Names of the hop-by-hop headers, including the ones listed in Connection */
+std::vector<std::string> hopByHop(const HeaderList& headers) {
+  std::vector<std::string> names(std::begin(HOP_BY_HOP), std::end(HOP_BY_HOP));
+  for (auto& header : headers) {
+    if (header.first == "connection") {
+      auto listed = tokens(header.second);
+      names.insert(names.end(), listed.begin(), listed.end());
+    }
+  }
+  return names;
+}
+
+bool contains(const std::vector<std::string>& names, const std::string& name) {
+  return std::find(names.begin(), names.end(), name) != names.end();
+}
+}  // namespace
+
+namespace ReverseProxy {
+
+bool Routes::add(const std::string& spec) {
+  auto equal = spec.find('=');
+  auto colon = spec.rfind(':');
+  if (equal == std::string::npos || colon == std::string::npos || colon < equal) return false;
+  auto prefix = spec.substr(0, equal);
+  auto host = spec.substr(equal + 1, colon - equal - 1);
+  auto port = spec.substr(colon + 1);
+  if (prefix.empty() || prefix[0] != '/' || host.empty() || port.empty()) return false;
+  if (host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+
+  boost::asio::io_context io;
+  boost::asio::ip::tcp::resolver resolver(io);
+  boost::system::error_code ec;
+  auto results = resolver.resolve(host, port, ec);
+  if (ec || results.empty()) return false;
+  add(prefix, results.begin()->endpoint());
+  return true;
+}
+
+void Routes::add(const std::string& prefix, const boost::asio::ip::tcp::endpoint& endpoint) {
+  routes_.push_back({prefix, endpoint});
+  std::stable_sort(routes_.begin(), routes_.end(), [](const Route& a, const Route& b) {
+    return a.prefix.size() > b.prefix.size();
+  });
+}
+
+const Route* Routes::match(const std::string& path) const {
+  for (auto& route : routes_) {
+    auto& prefix = route.prefix;
+    if (path.compare(0, prefix.size(), prefix) != 0) continue;
+    if (path.size() == prefix.size() || prefix.back() == '/' || path[prefix.size()] == '/') {
+      return &route;
+    }
+  }
+  return nullptr;
+}
+
+UpstreamPool::UpstreamPool(size_t maxIdle, std::chrono::seconds idleTimeout)
+    : maxIdle_(maxIdle), idleTimeout_(idleTimeout) {}
+
+UpstreamPool::Local& UpstreamPool::local_() {
+  // elements of unordered_map don't move, the lists are only touched by their own thread
+  std::lock_guard<std::mutex> lock(mutex_);
+  return locals_[std::this_thread::get_id()];
+}
+
+std::unique_ptr<UpstreamPool::Socket> UpstreamPool::acquire(
+    const boost::asio::ip::tcp::endpoint& endpoint) {
+  auto& idle = local_()[endpoint];
+  auto now = std::chrono::steady_clock::now();
+  while (!idle.empty()) {
+    // the most recently used one first, it's least likely closed by the upstream
+    auto entry = std::move(idle.back());
+    idle.pop_back();
+    if (now - entry.since > idleTimeout_) continue;
+
+    // an idle connection must have nothing to read, otherwise the upstream closed it
+    boost::system::error_code ec;
+    char byte;
+    entry.socket->non_blocking(true, ec);
+    entry.socket->receive(boost::asio::buffer(&byte, 1), Socket::message_peek, ec);
+    if (ec != boost::asio::error::would_block) continue;
+    entry.socket->non_blocking(false, ec);
+    return std::move(entry.socket);
+  }
+  return nullptr;
+}
+
+void UpstreamPool::release(const boost::asio::ip::tcp::endpoint& endpoint,
+                           std::unique_ptr<Socket> socket) {
+  if (maxIdle_ == 0 || !socket || !socket->is_open()) return;
+  auto& idle = local_()[endpoint];
+  if (idle.size() >= maxIdle_) idle.pop_front();
+  idle.push_back({std::move(socket), std::chrono::steady_clock::now()});
+}
+
+size_t UpstreamPool::idleCount(const boost::asio::ip::tcp::endpoint& endpoint) {
+  auto& local = local_();
+  auto it = local.find(endpoint);
+  return it == local.end() ? 0 : it->second.size();
+}
+
+bool idempotent(const std::string& method) {
+  // methods are case-sensitive
+  return method == "GET" || method == "HEAD" || method == "OPTIONS" || method == "PUT" ||
+         method == "DELETE";
+}
+
+bool forwardRequestHead(const std::string& head, const std::string& clientAddress,
+                        std::string& out, BodyFramer& body) {
+  std::string requestLine;
+  HeaderList headers;
+  if (!parseHead(head, requestLine, headers)) return false;
+  auto firstSpace = requestLine.find(' ');
+  auto lastSpace = requestLine.rfind(' ');
+  if (firstSpace == lastSpace || requestLine.compare(lastSpace + 1, 7, "HTTP/1.") != 0) {
+    return false;
+  }
+
+  bool chunked, encoded, hasLength;
+  uint64_t length;
+  if (!bodyMode(headers, chunked, encoded, hasLength, length)) return false;
+  if (encoded) {
+    // the length of a request body must be known, RFC 7230 section 3.3.3
+    if (!chunked) return false;
+    body.reset(BodyFramer::Mode::CHUNKED);
+  } else if (hasLength) {
+    body.reset(BodyFramer::Mode::LENGTH, length);
+  } else {
+    body.reset(BodyFramer::Mode::NONE);
+  }
+
+  auto dropped = hopByHop(headers);
+  std::string forwardedFor;
+  out = requestLine + "\r\n";
+  for (auto& header : headers) {
+    if (contains(dropped, header.first)) continue;
+    if (encoded && header.first == "content-length") continue;
+    if (header.first == "x-forwarded-for") {
+      forwardedFor += header.second + ", ";
+      continue;
+    }
+    out += header.first + ": " + header.second + "\r\n";
+  }
+  out += "x-forwarded-for: " + forwardedFor + clientAddress + "\r\n";
+  out += "connection: keep-alive\r\n\r\n";
+  return true;
+}
+
+bool forwardResponseHead(const std::string& head, const std::string& method, std::string& out,
+                         BodyFramer& body, bool& keepAlive, unsigned& status) {
+  std::string statusLine;
+  HeaderList headers;
+  if (!parseHead(head, statusLine, headers)) return false;
+  if (statusLine.size() < 12 || statusLine.compare(0, 7, "HTTP/1.") != 0 || statusLine[8] != ' ' ||
+      !std::all_of(statusLine.begin() + 9, statusLine.begin() + 12,
+                   [](char c) { return c >= '0' && c <= '9'; })) {
+    return false;
+  }
+  status = std::stoul(statusLine.substr(9, 3));
+  // Upgrade is never forwarded, so the upstream can't switch protocols
+  if (status == 101) return false;
+
+  bool http10 = statusLine[7] == '0';
+  keepAlive = !http10;
+  for (auto& header : headers) {
+    if (header.first != "connection") continue;
+    auto options = tokens(header.second);
+    if (contains(options, "close")) keepAlive = false;
+    if (http10 && contains(options, "keep-alive")) keepAlive = true;
+  }
+
+  bool chunked, encoded, hasLength;
+  uint64_t length;
+  if (!bodyMode(headers, chunked, encoded, hasLength, length)) return false;
+  if (method == "HEAD" || status < 200 || status == 204 || status == 304) {
+    body.reset(BodyFramer::Mode::NONE);
+  } else if (chunked) {
+    body.reset(BodyFramer::Mode::CHUNKED);
+  } else if (encoded || !hasLength) {
+    body.reset(BodyFramer::Mode::UNTIL_CLOSE);
+    keepAlive = false;
+  } else {
+    body.reset(BodyFramer::Mode::LENGTH, length);
+  }
+
+  // the client always talks HTTP/1.1 with us
+  auto dropped = hopByHop(headers);
+  out = "HTTP/1.1" + statusLine.substr(8) + "\r\n";
+  for (auto& header : headers) {
+    if (contains(dropped, header.first)) continue;
+    if (encoded && header.first == "content-length") continue;
+    out += header.first + ": " + header.second + "\r\n";
+  }
+  if (body.mode() == BodyFramer::Mode::UNTIL_CLOSE) out += "connection: close\r\n";
+  out += "\r\n";
+  return true;
+}
+
+}  // namespace ReverseProxy
@@ -0,0 +1,149 @@
+#include "include/static_files.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+// Whether an Accept-Encoding value allows gzip, which is refused only by "q=0".
+bool acceptsGzip(const std::string& accept) {
+  size_t begin = 0;
+  while (begin < accept.size()) {
+    auto end = std::min(accept.find(',', begin), accept.size());
+    auto coding = accept.substr(begin, end - begin);
+    begin = end + 1;
+    auto params = coding.find(';');
+    auto name = coding.substr(0, params);
+    name.erase(std::remove(name.begin(), name.end(), ' '), name.end());
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    if (name != "gzip" && name != "*") continue;
+    if (params == std::string::npos) return true;
+    auto q = coding.find("q=", params);
+    return q == std::string::npos || std::atof(coding.c_str() + q + 2) > 0;
+  }
+  return false;
+}
+
+// Absolute path of a request path, the key of the file cache.
+std::string filePath(const std::string& pathname) {
+  return (boost::filesystem::current_path() / pathname).string();
+}
+
+// Key of pathname in the popularity list, "/a.txt" for "//a.txt", "/./a.txt" or "/b/../a.txt",
+// so the aliases of a file are counted as one path.
+std::string popularKey(const std::string& pathname) {
+  std::vector<std::string> segments;
+  size_t begin = 0;
+  while (begin <= pathname.size()) {
+    auto end = std::min(pathname.find('/', begin), pathname.size());
+    auto segment = pathname.substr(begin, end - begin);
+    begin = end + 1;
+    if (segment.empty() || segment == ".") continue;
+    if (segment == "..") {
+      if (!segments.empty()) segments.pop_back();
+      continue;
+    }
+    segments.push_back(std::move(segment));
+  }
+  std::string key;
+  for (auto& segment : segments) key += "/" + segment;
+  return key.empty() ? "/" : key;
+}
+
+// Ask the kernel to read the pages of [data, data + size) ahead, data needn't be aligned.
+void willNeed(const char* data, size_t size) {
+  auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  auto begin = reinterpret_cast<uintptr_t>(data) & ~(page - 1);
+  madvise(reinterpret_cast<void*>(begin), reinterpret_cast<uintptr_t>(data) + size - begin,
+          MADV_WILLNEED);
+}
+}  // namespace
+
+CacheContent StaticFiles::load(const ServerContext& context, const std::string& path) {
+  auto& cache = context.cache;
+  CacheContent file;
+  if (cache && cache->find(path, file)) return file;
+
+  auto type = context.mime ? context.mime->lookup(path) : MimeTypes::lookupBuiltin(path);
+  auto mmapThreshold = cache ? cache->maxObjectSize() + 1 : context.mmapThreshold;
+  file = CacheContent::fromFile(path, mmapThreshold, context.cacheTtl, type);
+  if (cache && file.isValid()) cache->put(path, file);
+  return file;
+}
+
+CacheContent StaticFiles::respond(const ServerContext& context,
+                                  const HttpUtils::HttpRequest& request,
+                                  HttpUtils::HttpResponse& response) {
+  if (context.bundle) return respondBundle(context, request, response);
+  auto file = load(context, filePath(request.pathname));
+  if (file.isValid()) {
+    if (context.popularity) context.popularity->record(popularKey(request.pathname));
+    response.setStatus(200).setMessage("OK").setContentLength(file.size()).setContentType(
+        file.contentType());
+  } else {
+    response.setStatus(404).setMessage("Not Found");
+  }
+  return file;
+}
+
+CacheContent StaticFiles::respondBundle(const ServerContext& context,
+                                        const HttpUtils::HttpRequest& request,
+                                        HttpUtils::HttpResponse& response) {
+  AssetBundle::Asset asset;
+  if (!context.bundle->find(request.pathname, asset)) {
+    response.setStatus(404).setMessage("Not Found");
+    return CacheContent();
+  }
+  if (context.popularity) context.popularity->record(popularKey(request.pathname));
+
+  auto gzip = asset.gzip && acceptsGzip(request.header("Accept-Encoding"));
+  auto etag = gzip ? asset.gzipEtag : asset.etag;
+  auto body = gzip ? asset.gzip : asset.body;
+  auto size = gzip ? asset.gzipSize : asset.size;
+  response.setContentType(asset.contentType).setHeader("etag", etag);
+  if (asset.gzip) response.setHeader("vary", "accept-encoding");
+  if (gzip) response.setHeader("content-encoding", "gzip");
+
+  auto match = request.header("If-None-Match");
+  if (!match.empty() && (match.find(etag) != std::string::npos || match == "*")) {
+    // the length of the representation, there is no body
+    response.setStatus(304).setMessage("Not Modified").setContentLength(size);
+    return CacheContent();
+  }
+  response.setStatus(200).setMessage("OK").setContentLength(size);
+  // aliasing constructor, the body keeps the whole bundle mapped
+  return CacheContent::fromMemory(std::shared_ptr<const char>(context.bundle, body), size,
+                                  asset.contentType);
+}
+
+bool StaticFiles::warm(const ServerContext& context, const std::string& pathname) {
+  if (context.bundle) {
+    AssetBundle::Asset asset;
+    if (!context.bundle->find(pathname, asset)) return false;
+    willNeed(asset.body, asset.size);
+    if (asset.gzip) willNeed(asset.gzip, asset.gzipSize);
+    return true;
+  }
+
+  auto path = filePath(pathname);
+  boost::system::error_code ec;
+  auto size = boost::filesystem::file_size(path, ec);
+  if (ec) return false;
+  if (context.cache && size <= context.cache->maxObjectSize()) {
+    auto type = context.mime ? context.mime->lookup(path) : MimeTypes::lookupBuiltin(path);
+    auto file = CacheContent::fromFile(path, size + 1, context.cacheTtl, type);
+    // not a request, the hit ratios of the cache are left alone
+    return context.cache->prefill(path, file);
+  }
+
+  // too large for the cache or no cache, the first request still reads from the page cache
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  auto advised = posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) == 0;
+  close(fd);
+  return advised;
+}
@@ -1,63 +1,240 @@
 #include "include/thread_pool.hpp"
+#include <algorithm>
 #include <iostream>
 
+namespace {
+// Prevent generating too many threads, at most this many per hardware thread.
+const ushort THREAD_SCALE_LIMIT = 5;
+
+// Share of the workers each Priority class gets while all of them have jobs, HIGH first.
+const int PRIORITY_WEIGHTS[] = {4, 2, 1};
+
+// Shortest period of the elastic controller.
+const std::chrono::microseconds MIN_CONTROL_PERIOD(500);
+
+std::chrono::microseconds elapsed(std::chrono::steady_clock::time_point from,
+                                  std::chrono::steady_clock::time_point to) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(to - from);
+}
+}  // namespace
+
 ThreadPool::ThreadPool(uint16_t poolSize) {
   auto max_concurrency = std::thread::hardware_concurrency();
   uint16_t size_ = poolSize > 0 ? poolSize : 1;
-  const ushort THREAD_SCALE_LIMIT = 5;
 
   // Prevent generating too many threads
   if(size_ > max_concurrency * THREAD_SCALE_LIMIT)
     size_ = max_concurrency * THREAD_SCALE_LIMIT;
   available_.store(size_);
   processing_.store(true);
+  threads_ = size_;
   for (int i = 0; i < size_; ++i) {
     workers_.emplace_back(std::bind(&ThreadPool::initThread, this));
   }
 }
 
+ThreadPool::ThreadPool(const Elastic& options) : elastic_(true), options_(options) {
+  uint16_t limit = std::max(1u, std::thread::hardware_concurrency() * THREAD_SCALE_LIMIT);
+  options_.maxWorkers = std::min(std::max<uint16_t>(options_.maxWorkers, 1), limit);
+  options_.minWorkers = std::min(options_.minWorkers, options_.maxWorkers);
+  available_.store(0);
+  processing_.store(true);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < options_.minWorkers; ++i) spawn_();
+  }
+  controller_ = std::thread(&ThreadPool::control_, this);
+}
+
 ThreadPool::~ThreadPool() {
   if(processing_.load()) {
     abort();
   }
 }
 
+ThreadPool::CancelToken ThreadPool::CancelToken::create() {
+  return CancelToken(std::make_shared<std::atomic<bool>>(false));
+}
+
+ThreadPool::CancelToken::CancelToken(std::shared_ptr<std::atomic<bool>> flag)
+    : flag_(std::move(flag)) {}
+
+void ThreadPool::CancelToken::cancel() const {
+  if (flag_) flag_->store(true);
+}
+
+bool ThreadPool::CancelToken::cancelled() const { return flag_ && flag_->load(); }
+
+void ThreadPool::push_(Task task, const Schedule& schedule) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_[static_cast<size_t>(schedule.priority)].push_back(
+        {std::move(task), Clock::now(), schedule.deadline, schedule.token});
+  }
+
+  cv_.notify_one();
+}
+
+bool ThreadPool::pending_() const {
+  for (auto& jobs : jobs_) {
+    if (!jobs.empty()) return true;
+  }
+  return false;
+}
+
+ThreadPool::Job ThreadPool::pop_() {
+  size_t selected = PRIORITY_CLASSES;
+  int total = 0;
+  for (size_t i = 0; i < PRIORITY_CLASSES; ++i) {
+    // an empty class does not save up credits for a later burst
+    if (jobs_[i].empty()) {
+      credits_[i] = 0;
+      continue;
+    }
+    credits_[i] += PRIORITY_WEIGHTS[i];
+    total += PRIORITY_WEIGHTS[i];
+    if (selected == PRIORITY_CLASSES || credits_[i] > credits_[selected]) selected = i;
+  }
+  credits_[selected] -= total;
+
+  auto job = std::move(jobs_[selected].front());
+  jobs_[selected].pop_front();
+  return job;
+}
+
 void ThreadPool::initThread() {
+  std::unique_lock<std::mutex> lock(mutex_);
   while (processing_.load()) {
-    std::function<void()> task;
-    {
-      std::unique_lock<std::mutex> lock(mutex_);
-      cv_.wait(lock, [this] {
-        // if pool is running and exists pending jobs, stop blocking thread
-        bool condition = !jobs_.empty() || !processing_.load();
-        return condition;
-      });
-      if (!processing_.load() || jobs_.empty()) return;
-
-      task = std::move(jobs_.front());
-      jobs_.pop_front();
+    // if pool is running and exists pending jobs, stop blocking thread
+    auto ready = [this] { return pending_() || !processing_.load(); };
+    if (!elastic_) {
+      cv_.wait(lock, ready);
+    } else if (!cv_.wait_for(lock, options_.idleGrace, ready)) {
+      // idle for the whole grace period
+      if (threads_ <= options_.minWorkers) continue;
+      threads_--;
+      --available_;
+      stats_.retired++;
+      retired_.push_back(std::this_thread::get_id());
+      return;
+    }
+    if (!processing_.load() || !pending_()) return;
+
+    auto job = pop_();
+    auto start = Clock::now();
+    bool cancelled = job.token.cancelled();
+    if (cancelled || start > job.deadline) {
+      // dropped without taking the worker for the job itself, only its future is failed
+      (cancelled ? stats_.cancelled : stats_.expired)++;
+      lock.unlock();
+      job.task(cancelled ? std::make_exception_ptr(Cancelled())
+                         : std::make_exception_ptr(Expired()));
+      lock.lock();
+      continue;
     }
+    auto wait = elapsed(job.queued, start);
+    stats_.totalWait += wait;
+    stats_.maxWait = std::max(stats_.maxWait, wait);
     --available_;
-    task();
+    lock.unlock();
+
+    job.task(nullptr);
     ++available_;
+
+    auto run = elapsed(start, Clock::now());
+    lock.lock();
+    stats_.completed++;
+    stats_.totalRun += run;
+    stats_.maxRun = std::max(stats_.maxRun, run);
   }
 }
 
+void ThreadPool::control_() {
+  auto period = std::max(options_.targetWait / 2, MIN_CONTROL_PERIOD);
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (processing_.load()) {
+    controlCv_.wait_for(lock, period);
+    if (!processing_.load()) return;
+    reap_();
+    if (!pending_() || available_.load() > 0 || threads_ >= options_.maxWorkers) continue;
+
+    // every class is FIFO, the oldest job is at the front of one of them
+    auto now = Clock::now();
+    auto oldest = now;
+    size_t queued = 0;
+    for (auto& jobs : jobs_) {
+      if (jobs.empty()) continue;
+      oldest = std::min(oldest, jobs.front().queued);
+      queued += jobs.size();
+    }
+    if (elapsed(oldest, now) <= options_.targetWait) continue;
+
+    // every queued job is late, bursts get a worker for each of them
+    auto grow = std::min(queued, options_.maxWorkers - threads_);
+    for (size_t i = 0; i < grow; ++i) spawn_();
+    stats_.grown += grow;
+  }
+}
+
+void ThreadPool::spawn_() {
+  threads_++;
+  ++available_;
+  workers_.emplace_back(std::bind(&ThreadPool::initThread, this));
+}
+
+void ThreadPool::reap_() {
+  if (retired_.empty()) return;
+  for (auto it = workers_.begin(); it != workers_.end();) {
+    if (std::find(retired_.begin(), retired_.end(), it->get_id()) == retired_.end()) {
+      ++it;
+      continue;
+    }
+    // the retired worker holds no lock anymore, it is about to return
+    it->join();
+    it = workers_.erase(it);
+  }
+  retired_.clear();
+}
+
 void ThreadPool::abort() {
-  processing_.store(false);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    processing_.store(false);
+  }
+  controlCv_.notify_all();
+  if (controller_.joinable()) controller_.join();
   cv_.notify_all();
 
   for(auto it = workers_.begin(); it != workers_.end(); ++it)
       if(it->joinable()) it->join();
   {
     std::lock_guard<std::mutex> lock(mutex_);
-    while(!jobs_.empty())
-        jobs_.pop_back();
+    for (auto& jobs : jobs_)
+      while(!jobs.empty())
+          jobs.pop_back();
+    workers_.clear();
+    retired_.clear();
+    threads_ = 0;
   }
-  
+
   available_.store(0);
 }
 
-size_t ThreadPool::remainJobSize() const { return jobs_.size(); }
+size_t ThreadPool::remainJobSize() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t size = 0;
+  for (auto& jobs : jobs_) size += jobs.size();
+  return size;
+}
 
 size_t ThreadPool::avaliableWorkerSize() const { return available_.load(); }
+
+size_t ThreadPool::workerSize() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return threads_;
+}
+
+ThreadPool::Stats ThreadPool::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
@@ -0,0 +1,55 @@
+#include "include/tls_context.hpp"
+
+#include <openssl/ssl.h>
+
+#include <cstring>
+
+namespace {
+// Number of sessions kept by the server side session cache.
+const long SESSION_CACHE_SIZE = 20480;
+
+// Lifetime of a session or a session ticket, in seconds.
+const long SESSION_TIMEOUT = 3600;
+
+// Offered in ALPN, h2 first.
+const char ALPN_PROTOCOLS[] = "\x02h2\x08http/1.1";
+const char ALPN_HTTP1[] = "\x08http/1.1";
+
+// Choose the first protocol of ours which the client offers too, arg is our list.
+int selectAlpn(SSL* /* ssl */, const unsigned char** out, unsigned char* outlen,
+               const unsigned char* in, unsigned int inlen, void* arg) {
+  auto protocols = static_cast<const char*>(arg);
+  unsigned char* selected = nullptr;
+  if (SSL_select_next_proto(&selected, outlen, reinterpret_cast<const unsigned char*>(protocols),
+                            strlen(protocols), in, inlen) != OPENSSL_NPN_NEGOTIATED) {
+    return SSL_TLSEXT_ERR_NOACK;
+  }
+  *out = selected;
+  return SSL_TLSEXT_ERR_OK;
+}
+
+// Sessions issued by this server are only valid for this server.
+const unsigned char SESSION_ID_CONTEXT[] = "group1-http";
+}  // namespace
+
+std::shared_ptr<boost::asio::ssl::context> TlsContext::makeServerContext(
+    const std::string& certFile, const std::string& keyFile, bool http2) {
+  namespace ssl = boost::asio::ssl;
+  auto context = std::make_shared<ssl::context>(ssl::context::tls_server);
+  context->set_options(ssl::context::default_workarounds | ssl::context::no_sslv2 |
+                       ssl::context::no_sslv3 | ssl::context::no_tlsv1 |
+                       ssl::context::no_tlsv1_1 | ssl::context::single_dh_use);
+  context->use_certificate_chain_file(certFile);
+  context->use_private_key_file(keyFile, ssl::context::pem);
+
+  auto handle = context->native_handle();
+  SSL_CTX_set_session_cache_mode(handle, SSL_SESS_CACHE_SERVER);
+  SSL_CTX_sess_set_cache_size(handle, SESSION_CACHE_SIZE);
+  SSL_CTX_set_timeout(handle, SESSION_TIMEOUT);
+  SSL_CTX_set_session_id_context(handle, SESSION_ID_CONTEXT, sizeof(SESSION_ID_CONTEXT) - 1);
+  // stateless resumption, the ticket keys are generated by OpenSSL for this process
+  SSL_CTX_clear_options(handle, SSL_OP_NO_TICKET);
+  SSL_CTX_set_alpn_select_cb(handle, selectAlpn,
+                             const_cast<char*>(http2 ? ALPN_PROTOCOLS : ALPN_HTTP1));
+  return context;
+}
@@ -0,0 +1,150 @@
+#include "include/upload.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+// O_DIRECT wants buffers, offsets and sizes aligned to the logical block size,
+// 4096 covers every common device.
+const size_t DIRECT_ALIGNMENT = 4096;
+
+// Size of the staging buffer for O_DIRECT, a multiple of DIRECT_ALIGNMENT.
+const size_t STAGING_SIZE = 256 << 10;
+
+// Capacity asked for the splice pipe, the kernel default is 64 KB.
+const int PIPE_SIZE = 1 << 20;
+
+bool writeAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    auto written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+}  // namespace
+
+std::unique_ptr<Upload> Upload::create(const std::string& target, bool direct,
+                                       uint64_t expectedSize) {
+  auto slash = target.rfind('/');
+  auto directory = slash == std::string::npos ? std::string(".") : target.substr(0, slash);
+  auto path = directory + "/.upload-XXXXXX";
+
+  int fd = -1;
+  if (direct) {
+    fd = mkostemp(&path[0], O_CLOEXEC | O_DIRECT);
+    // Ex. tmpfs rejects O_DIRECT
+    if (fd < 0 && errno == EINVAL) {
+      path = directory + "/.upload-XXXXXX";
+      direct = false;
+    }
+  }
+  if (fd < 0 && !direct) fd = mkostemp(&path[0], O_CLOEXEC);
+  if (fd < 0) return nullptr;
+
+  // mkostemp creates the file 0600, the file is served to everyone after commit()
+  fchmod(fd, 0644);
+  if (expectedSize > 0) fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, expectedSize);
+  return std::unique_ptr<Upload>(new Upload(fd, path, target, direct));
+}
+
+Upload::Upload(int fd, std::string path, std::string target, bool direct)
+    : fd_(fd),
+      path_(std::move(path)),
+      target_(std::move(target)),
+      direct_(direct),
+      committed_(false),
+      size_(0),
+      staging_(nullptr, free),
+      staged_(0),
+      pipe_{-1, -1} {
+  void* buffer = nullptr;
+  if (direct_ && posix_memalign(&buffer, DIRECT_ALIGNMENT, STAGING_SIZE) == 0) {
+    staging_.reset(static_cast<char*>(buffer));
+  } else if (direct_) {
+    direct_ = false;
+    fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+  }
+}
+
+Upload::~Upload() {
+  if (pipe_[0] >= 0) {
+    close(pipe_[0]);
+    close(pipe_[1]);
+  }
+  close(fd_);
+  if (!committed_) unlink(path_.c_str());
+}
+
+bool Upload::write(const char* data, size_t size) {
+  size_ += size;
+  if (!direct_) return writeAll(fd_, data, size);
+
+  while (size > 0) {
+    auto length = std::min(size, STAGING_SIZE - staged_);
+    memcpy(staging_.get() + staged_, data, length);
+    staged_ += length;
+    data += length;
+    size -= length;
+    if (staged_ == STAGING_SIZE && !flush_(false)) return false;
+  }
+  return true;
+}
+
+bool Upload::flush_(bool all) {
+  auto blocks = staged_ / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+  if (blocks > 0 && !writeAll(fd_, staging_.get(), blocks)) return false;
+  staged_ -= blocks;
+  memmove(staging_.get(), staging_.get() + blocks, staged_);
+  if (!all || staged_ == 0) return true;
+
+  // the tail is not a whole block, write it through the page cache
+  fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+  direct_ = false;
+  bool ok = writeAll(fd_, staging_.get(), staged_);
+  staged_ = 0;
+  return ok;
+}
+
+ssize_t Upload::spliceFrom(int fd, size_t size) {
+  if (direct_) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (pipe_[0] < 0) {
+    if (pipe2(pipe_, O_CLOEXEC | O_NONBLOCK) < 0) return -1;
+    fcntl(pipe_[1], F_SETPIPE_SZ, PIPE_SIZE);
+  }
+
+  auto moved = splice(fd, nullptr, pipe_[1], nullptr, size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  if (moved <= 0) return moved;
+  for (ssize_t left = moved; left > 0;) {
+    auto written = splice(pipe_[0], nullptr, fd_, nullptr, left, SPLICE_F_MOVE);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) {
+      if (written == 0) errno = EIO;
+      return -1;
+    }
+    left -= written;
+  }
+  size_ += moved;
+  return moved;
+}
+
+bool Upload::commit() {
+  if (direct_ && !flush_(true)) return false;
+  if (rename(path_.c_str(), target_.c_str()) != 0) return false;
+  committed_ = true;
+  return true;
+}
@@ -24,14 +24,18 @@
 #ifndef CACHE_CONTENT_H_
 #define CACHE_CONTENT_H_
 
+#include <ctime>
+#include <memory>
 #include <string>
 
 /**
  * 包裝實際的檔案
  * 讓其具有過期以及讀檔狀態的概念
+ * 小檔案會被讀進 heap, 大檔案則用 mmap 映射, 複製 CacheContent 只會增加 reference count,
+ * 所以同一份檔案內容可以同時傳給很多連線.
  * Example:
- * CacheContent cc = hash.find("some/file.txt");
- * if (cc != hash.end()) {
+ * CacheContent cc;
+ * if (cache.find("some/file.txt", cc)) {
  *   if (cc.isValid()) callback(cc);
  *   if (cc.isExpired()) doOpenFile();
  *   if (cc.isPending()) callbackAfterFileOpened();
@@ -47,26 +51,46 @@ class CacheContent {
   // movable
   CacheContent& operator=(const CacheContent&) = default;
   ~CacheContent();
+  // read the file, if it's not smaller than mmap_threshold, map it instead of reading.
+  // ttl is in second, 0 means never expired.
+  // the returned content is not ready if the file can't be read.
+  static CacheContent fromFile(const std::string& path, size_t mmap_threshold, time_t ttl,
+                               const char* content_type);
+  // wrap bytes owned by another object, Ex. a mapped AssetBundle, content keeps the owner alive.
+  // it never expires, and like a mapped file it's not stored by FileCache.
+  static CacheContent fromMemory(std::shared_ptr<const char> content, size_t size,
+                                 const char* content_type);
   // get the content variable
   const std::string getContent();
+  // the content bytes, valid as long as any copy of this object
+  const char* data() const;
+  size_t size() const;
+  const char* contentType() const;
+  // the content is mapped from file, not on heap
+  bool isMapped() const;
   // is_ready and is not expired
-  bool isValid();
+  bool isValid() const;
   // not is_ready and is not expired
-  bool isPending();
+  bool isPending() const;
   // read_at is too old
-  bool isExpired();
+  bool isExpired() const;
 
  private:
   // the content, the worker need to read the file and
-  // put it here.
-  std::string* content;
+  // put it here. It's shared by every copy of this object.
+  std::shared_ptr<const char> content;
+  size_t content_size;
+  // content-type of the file, owned by MimeTypes
+  const char* content_type;
   // if the worker done read, call the callback and set is_ready
   // to true.
   bool is_ready;
+  bool is_mapped;
   // time start reading file, if it's too old (expired) then
   // the isValid function should return false and we need to
   // re-load the file into cache.
   time_t read_at;
+  time_t ttl;
 };
 
 #endif
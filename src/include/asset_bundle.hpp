@@ -0,0 +1,125 @@
+/*
+ * MIT License
+ * Copyright (c) 2021 Yen Hao, Chen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GROUP1_ASSET_BUNDLE_H_
+#define _GROUP1_ASSET_BUNDLE_H_
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "include/mime_types.hpp"
+
+/**
+ * @brief
+ * AssetBundle is a document root packed into one immutable file, built ahead of deploy
+ * by pack() and served by mapping the whole file at startup.
+ *
+ * The file begins with a header and an open addressing hash table of the paths, followed by
+ * a fixed size entry for each file and the strings they refer to: path, content-type,
+ * and the ETag of the body and of its gzip variant.
+ * Bodies come after that. A body of a page or more starts on a page boundary,
+ * a smaller one never crosses a page boundary, so it's read by one page fault.
+ * A body which gzip shrinks by an eighth or more also has a compressed copy.
+ * A CRC-32 of everything after the header detects a truncated or damaged file.
+ * Numbers are stored in native byte order, a bundle is read on the platform which built it.
+ *
+ * A lookup is one hash and a probe, the returned pointers point into the mapped file,
+ * so a response is written straight from the page cache, which is shared by every process
+ * serving the same bundle.
+ *
+ * @example use AssetBundle
+ *
+ * @code
+ * std::string error;
+ * AssetBundle::pack("/srv/www", "/srv/www.bundle", nullptr, error);
+ *
+ * auto bundle = AssetBundle::open("/srv/www.bundle", error);
+ * AssetBundle::Asset asset;
+ * if (bundle && bundle->find("/index.html", asset)) send(asset.body, asset.size);
+ */
+class AssetBundle {
+ public:
+  /**
+   * View of a packed file, valid as long as the bundle.
+   * gzip is nullptr and gzipSize is 0 if there is no compressed variant.
+   * The ETags are quoted, ready for the etag header.
+   */
+  struct Asset {
+    const char* body;
+    uint64_t size;
+    const char* gzip;
+    uint64_t gzipSize;
+    const char* etag;
+    const char* gzipEtag;
+    const char* contentType;
+  };
+
+  /**
+   * Pack every regular file under root into output, the path of a file is "/" followed by
+   * its path relative to root. Content-types are looked up in mime, or the built-in table
+   * if it's null. output is replaced at once when it's complete.
+   * Return false and set error if a file can't be read or output can't be written.
+   */
+  static bool pack(const std::string& root, const std::string& output, const MimeTypes* mime,
+                   std::string& error);
+
+  /**
+   * Map the bundle at path and check its header and table, and its checksum if verify.
+   * Return nullptr and set error if the file is not a valid bundle.
+   */
+  static std::shared_ptr<const AssetBundle> open(const std::string& path, std::string& error,
+                                                 bool verify = true);
+
+  AssetBundle(AssetBundle&) = delete;
+  AssetBundle& operator=(AssetBundle&) = delete;
+  ~AssetBundle();
+
+  /**
+   * Find the file of path, Ex. "/css/site.css", return false if it's not in the bundle.
+   */
+  bool find(const std::string& path, Asset& asset) const;
+
+  /**
+   * Number of files in the bundle.
+   */
+  size_t size() const { return count_; }
+
+ private:
+  /* Layout of the file, defined with the format */
+  struct Header;
+  struct Entry;
+
+  AssetBundle(const char* base, size_t length);
+
+  /* The mapped file */
+  const char* base_;
+  size_t length_;
+
+  /* Parts of the file, set by open() */
+  const uint32_t* slots_ = nullptr;
+  uint32_t mask_ = 0;
+  const Entry* entries_ = nullptr;
+  uint32_t count_ = 0;
+  const char* strings_ = nullptr;
+};
+
+#endif  // _GROUP1_ASSET_BUNDLE_H_
@@ -0,0 +1,113 @@
+/*
+ * MIT License
+ * Copyright (c) 2021 Yen Hao, Chen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GROUP1_BODY_FRAMER_H_
+#define _GROUP1_BODY_FRAMER_H_
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief
+ * Find the end of an HTTP/1.1 message body as its bytes pass through, without buffering it.
+ * Chunked bodies are tracked by a small state machine, chunk extensions and trailers included,
+ * consume() keeps the chunked coding, decode() strips it in place.
+ *
+ * @example use BodyFramer
+ *
+ * @code
+ * BodyFramer body;
+ * body.reset(BodyFramer::Mode::CHUNKED);
+ * while (!body.done()) {
+ *   auto size = read(buffer);
+ *   size_t payload = 0;
+ *   body.decode(buffer, size, payload);
+ *   if (body.error()) return badRequest();
+ *   file.write(buffer, payload);
+ * }
+ */
+class BodyFramer {
+ public:
+  enum class Mode { NONE, LENGTH, CHUNKED, UNTIL_CLOSE };
+
+  BodyFramer() { reset(Mode::NONE); }
+
+  void reset(Mode mode, uint64_t length = 0);
+
+  /**
+   * Return how many bytes of data belong to the body, the rest belongs to the next message.
+   * Check error() after it.
+   */
+  size_t consume(const char* data, size_t size);
+
+  /**
+   * Same as consume(), and move the payload of the consumed bytes to the front of data,
+   * payload is set to its size.
+   */
+  size_t decode(char* data, size_t size, size_t& payload);
+
+  /**
+   * Count size bytes of a LENGTH body which were moved without being seen, Ex. by splice.
+   */
+  void skip(uint64_t size);
+
+  /**
+   * The whole body has passed, never true for UNTIL_CLOSE.
+   */
+  bool done() const { return state_ == State::DONE; }
+
+  bool error() const { return state_ == State::ERROR; }
+
+  Mode mode() const { return mode_; }
+
+  /**
+   * Bytes left of a LENGTH body.
+   */
+  uint64_t remaining() const { return mode_ == Mode::LENGTH ? remaining_ : 0; }
+
+ private:
+  enum class State {
+    DATA,
+    CHUNK_SIZE,
+    CHUNK_EXTENSION,
+    CHUNK_SIZE_LF,
+    CHUNK_DATA_CR,
+    CHUNK_DATA_LF,
+    TRAILER_START,
+    TRAILER,
+    FINAL_LF,
+    UNTIL_CLOSE,
+    DONE,
+    ERROR
+  };
+
+  /**
+   * Shared by consume() and decode(), the payload is moved to out if it's not null.
+   */
+  size_t advance_(const char* data, size_t size, char* out, size_t& payload);
+
+  Mode mode_;
+  State state_;
+  uint64_t remaining_;
+  bool chunkSizeSeen_;
+};
+
+#endif  // _GROUP1_BODY_FRAMER_H_
@@ -0,0 +1,89 @@
+/*
+ * MIT License
+ * Copyright (c) 2021 Yen Hao, Chen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GROUP1_CACHE_WARMER_H_
+#define _GROUP1_CACHE_WARMER_H_
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "include/server_context.hpp"
+#include "include/thread_pool.hpp"
+
+/**
+ * @brief
+ * CacheWarmer preloads the paths saved by Popularity at startup, in parallel on a ThreadPool,
+ * so the hottest files are served from memory by the first requests after a restart.
+ * Each path is warmed by StaticFiles::warm().
+ *
+ * wait() is the readiness gate: HttpServer only starts listening once a fraction of the list
+ * is done, a load balancer sees the port refused and keeps routing to the other servers
+ * until then. The rest of the list is warmed while requests are served.
+ *
+ * The jobs only share the progress with the warmer, so it can be destroyed before them.
+ *
+ * @example use CacheWarmer
+ *
+ * @code
+ * ThreadPool pool(16);
+ * CacheWarmer warmer(context, Popularity::load("popular.txt", 1000));
+ * auto deadline = ThreadPool::Clock::now() + std::chrono::seconds(30);
+ * warmer.start(pool, deadline);
+ * warmer.wait(0.9, deadline);
+ */
+class CacheWarmer {
+ public:
+  CacheWarmer(CacheWarmer&) = delete;
+  CacheWarmer& operator=(CacheWarmer&) = delete;
+
+  CacheWarmer(std::shared_ptr<const ServerContext> context, std::vector<std::string> paths);
+
+  /**
+   * Dispatch one job per path on pool, in the order of the list.
+   * A job which starts after deadline only counts itself done, a slow disk can't hold
+   * the workers forever.
+   */
+  void start(ThreadPool& pool, ThreadPool::Clock::time_point deadline);
+
+  /**
+   * Block until at least fraction (0 to 1) of the paths are done, or deadline.
+   * Return true if the fraction was reached.
+   */
+  bool wait(double fraction, ThreadPool::Clock::time_point deadline) const;
+
+  /**
+   * Number of paths in the list, paths done (warmed, missing or skipped after the deadline),
+   * and paths warmed.
+   */
+  size_t total() const;
+  size_t done() const;
+  size_t warmed() const;
+
+ private:
+  struct Progress;
+
+  std::shared_ptr<const ServerContext> context_;
+  std::vector<std::string> paths_;
+  std::shared_ptr<Progress> progress_;
+};
+
+#endif  // _GROUP1_CACHE_WARMER_H_
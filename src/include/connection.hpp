@@ -23,10 +23,15 @@
 #ifndef _GROUP1_CONNECTION_H_
 #define _GROUP1_CONNECTION_H_
 #include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
 #include <chrono>
 #include <memory>
 #include <fstream>
 #include "http_utils.hpp"
+#include "include/http2_session.hpp"
+#include "include/server_context.hpp"
+#include "include/static_files.hpp"
+#include "include/upload.hpp"
 /**
  * @brief
  * This class corresponds to the session layer of the network OSI model,
@@ -44,6 +49,8 @@
  * connection.start();
  */
 class Connection : public std::enable_shared_from_this<Connection> {
+  using TlsStream = boost::asio::ssl::stream<boost::asio::ip::tcp::socket&>;
+
  public:
   /**
    * Every socket should bind to io_context,
@@ -58,8 +65,20 @@ class Connection : public std::enable_shared_from_this<Connection> {
    * According to asio official documents, a 4KB buffer should be able to handle most message.
    */
   Connection(boost::asio::io_context& io_context, uint buffer_size = 4096)
-      : socket_(io_context), strand_(io_context), buffer_size_(buffer_size) {
+      : Connection(io_context, std::make_shared<ServerContext>(), buffer_size){};
+
+  /**
+   * Same as above, context holds the objects shared by every connection of the server,
+   * Ex. rate limiter and admission controller.
+   */
+  Connection(boost::asio::io_context& io_context, std::shared_ptr<const ServerContext> context,
+             uint buffer_size = 4096)
+      : socket_(io_context),
+        buffer_size_(buffer_size),
+        strand_(io_context),
+        context_(std::move(context)) {
     buffer_ = std::make_unique<char[]>(buffer_size);
+    if (context_->tls) tls_ = std::make_unique<TlsStream>(socket_, *context_->tls);
   };
 
   /**
@@ -68,7 +87,7 @@ class Connection : public std::enable_shared_from_this<Connection> {
   boost::asio::ip::tcp::socket& socket();
 
   /**
-   * it just call read_() function.
+   * it just call read_() function, if TLS is enabled, do the handshake first.
    * Please note: it should be executed after Connection::service.run() called.
    *
    * In asynchronous model, Ex. use async_read(), async_write(),
@@ -104,6 +123,202 @@ class Connection : public std::enable_shared_from_this<Connection> {
    */
   void write_(size_t length);
 
+  /**
+   * Write header and body with one gather write, nothing is copied into buffer_.
+   * body shares the bytes with the file cache, so the same file can be sent
+   * to many connections at the same time.
+   */
+  void writeResponse_(std::string header, CacheContent body);
+
+  /**
+   * Called after a write is completed, read the next request or close the socket.
+   */
+  void written_(const boost::system::error_code& ec);
+
+  /**
+   * Read from the socket, or from the TLS stream if TLS is enabled.
+   */
+  template <typename Buffers, typename Condition, typename Handler>
+  void asyncRead_(const Buffers& buffers, Condition&& condition, Handler&& handler) {
+    if (tls_) {
+      boost::asio::async_read(*tls_, buffers, std::forward<Condition>(condition),
+                              std::forward<Handler>(handler));
+    } else {
+      boost::asio::async_read(socket_, buffers, std::forward<Condition>(condition),
+                              std::forward<Handler>(handler));
+    }
+  }
+
+  /**
+   * Read some bytes from the socket, or from the TLS stream if TLS is enabled.
+   */
+  template <typename Buffers, typename Handler>
+  void asyncReadSome_(const Buffers& buffers, Handler&& handler) {
+    if (tls_) {
+      tls_->async_read_some(buffers, std::forward<Handler>(handler));
+    } else {
+      socket_.async_read_some(buffers, std::forward<Handler>(handler));
+    }
+  }
+
+  /**
+   * Write to the socket, or to the TLS stream if TLS is enabled.
+   */
+  template <typename Buffers, typename Handler>
+  void asyncWrite_(const Buffers& buffers, Handler&& handler) {
+    if (tls_) {
+      boost::asio::async_write(*tls_, buffers, std::forward<Handler>(handler));
+    } else {
+      boost::asio::async_write(socket_, buffers, std::forward<Handler>(handler));
+    }
+  }
+
+  /**
+   * Shutdown and close the socket, errors are ignored.
+   */
+  void shutdown_();
+
+  /**
+   * Check rate limiter and admission controller,
+   * return 0 if the request is admitted, otherwise 429 or 503 and set retryAfter.
+   * ticket holds the admission slot.
+   */
+  ushort check_(AdmissionController::Ticket& ticket, uint32_t& retryAfter);
+
+  /**
+   * Look up the file of request by StaticFiles::respond(),
+   * set status, content-type and content-length of response. The returned content is the body.
+   */
+  CacheContent respond_(const HttpUtils::HttpRequest& request, HttpUtils::HttpResponse& response);
+
+  /**
+   * If request asks "Upgrade: h2c", reply 101 and switch to HTTP/2, the request becomes stream 1.
+   * Return false if the request is not an upgrade.
+   */
+  bool upgradeHttp2_(const HttpUtils::HttpRequest& request);
+
+  /**
+   * Switch to HTTP/2, data is the bytes already read, which begin with the connection preface.
+   */
+  void startHttp2_(const char* data, size_t size);
+
+  /**
+   * In HTTP/2 the socket is read and written at the same time,
+   * readHttp2_() passes every received bytes to http2_, and flushHttp2_() writes
+   * the frames of http2_ until there is nothing left.
+   */
+  void readHttp2_();
+  void flushHttp2_();
+
+  /**
+   * Handler of every HTTP/2 request, admission is checked for each stream.
+   */
+  Http2Session::Response respondHttp2_(const HttpUtils::HttpRequest& request);
+
+  /**
+   * Forward request to its upstream if its path matches a route, return false otherwise.
+   * headSize is the size of the request head in buffer_, and size is the bytes read,
+   * the bytes after the head are the beginning of the body.
+   */
+  bool forward_(const HttpUtils::HttpRequest& request, size_t headSize, size_t size);
+
+  /**
+   * Steps of a forwarded request, the request body is pumped to the upstream by pumpRequest_()
+   * while the response is read by readUpstream_(), both through a fixed size buffer.
+   * Every handler checks proxyAttempt_, so the handlers of an abandoned attempt do nothing.
+   */
+  void connectUpstream_();
+  void sendUpstream_();
+  void pumpRequest_();
+  void readUpstream_();
+  void forwardHead_();
+
+  /**
+   * Completion of a write to the upstream, pump the rest of the request body,
+   * or finish the exchange if the response ended during the write.
+   */
+  void requestWritten_(boost::system::error_code ec);
+
+  /**
+   * Write buffers of the response to the client,
+   * then forward the next head if interim, otherwise continue the body.
+   */
+  template <typename Buffers>
+  void writeClient_(const Buffers& buffers, bool interim) {
+    auto attempt = proxyAttempt_;
+    auto self = shared_from_this();
+    exchange_->clientWriting = true;
+    asyncWrite_(buffers, strand_.wrap([this, self, attempt, interim](boost::system::error_code ec,
+                                                                     std::size_t) {
+      if (attempt != proxyAttempt_) return;
+      exchange_->clientWriting = false;
+      if (ec) {
+        failProxy_();
+      } else if (interim) {
+        forwardHead_();
+      } else if (exchange_->response.done()) {
+        finishProxy_();
+      } else {
+        readUpstream_();
+      }
+    }));
+  }
+
+  /**
+   * Park the upstream connection if it can be reused, then read the next request.
+   */
+  void finishProxy_();
+
+  /**
+   * Retry on a new upstream connection if a pooled one was closed and the request is
+   * replayable, otherwise answer 502, or close the connection if the response has begun.
+   */
+  void failProxy_();
+
+  /**
+   * Store the body of a PUT or POST request at its path, return false if the request has
+   * no body and uploads are disabled, then it's served as usual.
+   * headSize is the size of the request head in buffer_, and size is the bytes read.
+   */
+  bool receive_(const HttpUtils::HttpRequest& request, size_t headSize, size_t size);
+
+  /**
+   * Steps of an upload, a Content-Length body on a plain socket is spliced to the file,
+   * others are read into uploadBuffer_ and decoded there.
+   */
+  void receiveBody_();
+  void spliceBody_();
+  void readBody_();
+
+  /**
+   * Write payload to upload_, or answer 400, 413 or 500 and return false.
+   */
+  bool store_(const char* data, size_t size);
+
+  /**
+   * Rename the file onto its path and answer 201, or 200 if it replaced a file.
+   */
+  void finishUpload_();
+
+  /**
+   * Remove the temp file, then answer status and close, or just close if the client is gone.
+   */
+  void failUpload_(ushort status, const char* message);
+  void abortUpload_();
+
+  /**
+   * Check rate limiter and admission controller before the request is parsed.
+   * If the request is rejected, a 429 or 503 response is written,
+   * the connection will be closed after that, and false is returned.
+   */
+  bool admit_();
+
+  /**
+   * Write a response without body, with Retry-After header unless retryAfter is 0,
+   * then close the connection.
+   */
+  void reject_(ushort status, const char* message, uint32_t retryAfter);
+
   /**
    * socket instance, providing read/write interface
    */
@@ -129,5 +344,63 @@ class Connection : public std::enable_shared_from_this<Connection> {
   size_t buffer_size_;
 
   boost::asio::io_context::strand strand_;
+
+  /**
+   * TLS layer on top of socket_, null if TLS is not enabled.
+   */
+  std::unique_ptr<TlsStream> tls_;
+
+  /**
+   * Shared by every connection of the server, never null.
+   */
+  std::shared_ptr<const ServerContext> context_;
+
+  /**
+   * Slot of admission controller, held from the request is read until the response is written.
+   */
+  AdmissionController::Ticket ticket_;
+
+  /**
+   * Header and body of the response being written, kept alive until the write is completed.
+   */
+  std::string header_;
+  CacheContent body_;
+
+  /**
+   * Framing layer, null until the connection switches to HTTP/2.
+   */
+  std::unique_ptr<Http2Session> http2_;
+  std::vector<boost::asio::const_buffer> http2Buffers_;
+  bool writing_ = false;
+
+  /**
+   * Set by shutdown_(), so the socket is closed only once.
+   */
+  bool closed_ = false;
+
+  /**
+   * Deadline of the TLS shutdown, a peer which never answers close_notify can't keep
+   * the connection and its admission slot.
+   */
+  std::unique_ptr<boost::asio::steady_timer> shutdownTimer_;
+
+  /**
+   * Request being forwarded to an upstream, and the number of the current attempt.
+   */
+  std::unique_ptr<ReverseProxy::Exchange> exchange_;
+  unsigned proxyAttempt_ = 0;
+
+  /**
+   * Body being uploaded, memory used is bounded by uploadBuffer_ and the staging buffer of Upload.
+   */
+  std::unique_ptr<Upload> upload_;
+  BodyFramer uploadBody_;
+  std::unique_ptr<char[]> uploadBuffer_;
+  bool uploadExisted_ = false;
+
+  /**
+   * If true, write_() closes the socket instead of reading next request.
+   */
+  bool close_ = false;
 };
 #endif  //_GROUP1_CONNECTION_H_
@@ -0,0 +1,120 @@
+/*
+ * MIT License
+ * Copyright (c) 2021 Yen Hao, Chen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GROUP1_CORO_CONNECTION_H_
+#define _GROUP1_CORO_CONNECTION_H_
+// Boost 1.74 awaitable.hpp uses std::exchange without including <utility>
+#include <utility>
+#include <boost/asio.hpp>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "include/server_context.hpp"
+
+/**
+ * @brief
+ * CoroConnection serves HTTP/1.1 files like Connection, written as one C++20 coroutine
+ * which loops over the requests of a keep-alive connection,
+ * instead of a chain of callbacks which each hold a shared_ptr of the connection.
+ * The coroutine owns the only reference, and every read and write takes its handler memory
+ * from the two slots of the connection through the associated allocator,
+ * so a request doesn't allocate for I/O.
+ *
+ * It serves files from the root or the bundle with the rate limiter and admission controller,
+ * TLS, HTTP/2, proxy routes and uploads are only handled by Connection.
+ * This header is plain C++14, only its implementation is built as C++20.
+ *
+ * @example
+ *
+ * @code
+ * auto conn = std::make_shared<CoroConnection>(io_context, context);
+ * acceptor.async_accept(conn->socket(), [conn](boost::system::error_code ec) {
+ *   if (!ec) conn->start();
+ * });
+ */
+class CoroConnection : public std::enable_shared_from_this<CoroConnection> {
+ public:
+  /**
+   * Memory for the handlers of one connection, an operation takes a free slot if it's large
+   * enough, otherwise it falls back to the heap. Operations of one connection never overlap,
+   * so the slots are not locked.
+   */
+  class HandlerMemory {
+   public:
+    HandlerMemory() = default;
+    HandlerMemory(HandlerMemory&) = delete;
+    HandlerMemory& operator=(HandlerMemory&) = delete;
+
+    void* allocate(size_t size);
+    void deallocate(void* pointer);
+
+    /* Number of allocations which took a slot */
+    size_t allocations() const { return allocations_; }
+
+    /* Number of allocations which didn't fit in a slot */
+    size_t fallbacks() const { return fallbacks_; }
+
+   private:
+    static const size_t SLOT_SIZE = 512;
+    static const size_t SLOTS = 2;
+    std::aligned_storage<SLOT_SIZE>::type slots_[SLOTS];
+    bool used_[SLOTS] = {};
+    size_t allocations_ = 0;
+    size_t fallbacks_ = 0;
+  };
+
+  /**
+   * Same as Connection, context is shared by every connection of the server,
+   * a request head larger than bufferSize closes the connection.
+   */
+  CoroConnection(boost::asio::io_context& io_context, std::shared_ptr<const ServerContext> context,
+                 size_t bufferSize = 4096);
+
+  boost::asio::ip::tcp::socket& socket();
+
+  /**
+   * Spawn the coroutine on the executor of the socket, it runs until the connection is closed.
+   */
+  void start();
+
+  const HandlerMemory& handlerMemory() const { return memory_; }
+
+ private:
+  /* The coroutine, defined with the C++20 implementation */
+  struct Loop;
+
+  boost::asio::ip::tcp::socket socket_;
+  std::shared_ptr<const ServerContext> context_;
+  size_t bufferSize_;
+
+  /* Bytes read and not parsed yet, the next pipelined request may begin here */
+  std::string input_;
+
+  /* Header of the response being written */
+  std::string header_;
+
+  HandlerMemory memory_;
+};
+
+#endif  // _GROUP1_CORO_CONNECTION_H_
@@ -0,0 +1,173 @@
+/*
+ * MIT License
+ * Copyright (c) 2021 Yen Hao, Chen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GROUP1_FILE_CACHE_H_
+#define _GROUP1_FILE_CACHE_H_
+#include <array>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "include/CacheContent.hpp"
+
+/**
+ * @brief
+ * FileCache keeps the content of files in memory, bounded by a byte budget.
+ *
+ * The cache is split into shards by the hash of the path, each shard owns its mutex
+ * and an equal part of the budget.
+ * Every shard is a segmented LRU: a new file enters the probation segment,
+ * and is promoted to the protected segment on its second hit.
+ * Files are evicted from the tail of probation first, so a scan through many files
+ * which are read only once can't push the hot files out.
+ *
+ * Files larger than maxObjectSize are never stored, they should be mapped
+ * by CacheContent::fromFile() on every request instead.
+ *
+ * @example use FileCache
+ *
+ * @code
+ * FileCache cache(64 << 20);
+ * CacheContent cc;
+ * if (!cache.find(path, cc)) {
+ *   cc = CacheContent::fromFile(path, cache.maxObjectSize(), 60, type);
+ *   cache.put(path, cc);
+ * }
+ */
+class FileCache {
+ public:
+  /**
+   * Statistics are counted separately for each size class:
+   * up to 4KB, 64KB, 1MB, and larger.
+   */
+  static const size_t SIZE_CLASSES = 4;
+
+  struct Stats {
+    std::array<size_t, SIZE_CLASSES> hits{};
+    // a miss is counted in the size class of the file put after it
+    std::array<size_t, SIZE_CLASSES> misses{};
+    std::array<size_t, SIZE_CLASSES> evictions{};
+    size_t entries = 0;
+    size_t bytes = 0;
+
+    /**
+     * hits / (hits + misses) of the size class, 0 if there was no request.
+     */
+    double hitRatio(size_t sizeClass) const;
+  };
+
+  FileCache(FileCache&) = delete;
+  FileCache& operator=(FileCache&) = delete;
+
+  /**
+   * capacity is the byte budget of the whole cache.
+   * maxObjectSize of 0 means capacity / shardSize / 8.
+   * shardSize is rounded up to a power of two.
+   */
+  explicit FileCache(size_t capacity, size_t maxObjectSize = 0, size_t shardSize = 16);
+
+  /**
+   * Copy the content of path to result and return true if it's cached and valid.
+   * An expired content is removed.
+   */
+  bool find(const std::string& path, CacheContent& result);
+
+  /**
+   * Insert or replace the content of path, only valid and not mapped content smaller than
+   * maxObjectSize is stored. Return true if it's stored.
+   */
+  bool put(const std::string& path, const CacheContent& content);
+
+  /**
+   * Same as put(), but no miss is counted and a cached content is kept,
+   * used to warm up the cache before any request. Return true if path is cached.
+   */
+  bool prefill(const std::string& path, const CacheContent& content);
+
+  /**
+   * Remove path from the cache.
+   */
+  void erase(const std::string& path);
+
+  /**
+   * Return the size limit of a single cached file.
+   */
+  size_t maxObjectSize() const;
+
+  /**
+   * Sum the counters of every shard.
+   */
+  Stats stats() const;
+
+  /**
+   * Return the size class of a file of size bytes.
+   */
+  static size_t sizeClass(size_t size);
+
+ private:
+  enum Segment { PROBATION, PROTECTED };
+
+  struct Entry {
+    std::string path;
+    CacheContent content;
+    Segment segment;
+  };
+
+  using EntryList = std::list<Entry>;
+
+  struct Shard {
+    std::mutex mutex;
+    EntryList probation;
+    EntryList protect;
+    std::unordered_map<std::string, EntryList::iterator> index;
+    size_t bytes = 0;
+    size_t protectedBytes = 0;
+    Stats stats;
+  };
+
+  Shard& shardOf_(const std::string& path);
+
+  /**
+   * Remove the entry of it from its segment, the caller holds the lock of shard.
+   */
+  void remove_(Shard& shard, EntryList::iterator it);
+
+  /**
+   * Evict from probation, then from protected, until shard.bytes fits the budget.
+   */
+  void evict_(Shard& shard);
+
+  /**
+   * Replace the entry of path by content if it may be stored, the caller holds the lock of shard.
+   */
+  bool insert_(Shard& shard, const std::string& path, const CacheContent& content);
+
+  size_t shardCapacity_;
+  size_t protectedCapacity_;
+  size_t maxObjectSize_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+#endif  // _GROUP1_FILE_CACHE_H_
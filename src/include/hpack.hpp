@@ -0,0 +1,166 @@
+/*
+ * MIT License
+ * Copyright (c) 2021 Yen Hao, Chen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GROUP1_HPACK_H_
+#define _GROUP1_HPACK_H_
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief
+ * HPACK (RFC 7541) header compression used by HTTP/2.
+ * Decoder and Encoder each own a dynamic table, one pair is used per connection,
+ * and header blocks must be processed in the order they are sent.
+ *
+ * @example use Hpack
+ *
+ * @code
+ * Hpack::Decoder decoder;
+ * Hpack::HeaderList headers;
+ * if (!decoder.decode(block.data(), block.size(), headers)) connectionError(COMPRESSION_ERROR);
+ *
+ * Hpack::Encoder encoder;
+ * std::string out;
+ * encoder.encode({{":status", "200"}, {"content-type", "text/html"}}, out);
+ */
+namespace Hpack {
+
+using Header = std::pair<std::string, std::string>;
+using HeaderList = std::vector<Header>;
+
+/**
+ * @brief
+ * Dynamic table, new entries are inserted at the front, and the oldest entries are
+ * evicted when the size (name + value + 32 for each entry) is over maxSize.
+ */
+class DynamicTable {
+ public:
+  explicit DynamicTable(size_t maxSize) : size_(0), maxSize_(maxSize) {}
+
+  void add(const std::string& name, const std::string& value);
+
+  /**
+   * index starts from 0, which is the newest entry.
+   */
+  const Header& get(size_t index) const { return entries_[index]; }
+
+  size_t count() const { return entries_.size(); }
+
+  size_t maxSize() const { return maxSize_; }
+
+  void setMaxSize(size_t maxSize);
+
+ private:
+  void evict_();
+
+  std::deque<Header> entries_;
+  size_t size_;
+  size_t maxSize_;
+};
+
+/**
+ * @brief
+ * Decode header blocks sent by the peer.
+ */
+class Decoder {
+ public:
+  /**
+   * maxTableSize is the SETTINGS_HEADER_TABLE_SIZE we announced,
+   * maxListSize bounds the decoded size of one header block.
+   */
+  explicit Decoder(size_t maxTableSize = 4096, size_t maxListSize = 65536);
+
+  /**
+   * Append the headers in block to headers.
+   * Return false if the block is malformed, which is a COMPRESSION_ERROR of the connection.
+   */
+  bool decode(const uint8_t* data, size_t size, HeaderList& headers);
+
+ private:
+  bool lookup_(uint64_t index, Header& header) const;
+
+  DynamicTable table_;
+  size_t maxTableSize_;
+  size_t maxListSize_;
+};
+
+/**
+ * @brief
+ * Encode header blocks sent to the peer.
+ * Headers found in the static or dynamic table are sent as an index,
+ * other headers are added to the dynamic table, except the ones whose value
+ * changes on every response, Ex. content-length.
+ * Strings are Huffman coded when it's shorter.
+ */
+class Encoder {
+ public:
+  explicit Encoder(size_t maxTableSize = 4096);
+
+  /**
+   * Apply SETTINGS_HEADER_TABLE_SIZE of the peer, a table size update
+   * is sent at the beginning of the next block.
+   */
+  void setMaxTableSize(size_t maxTableSize);
+
+  /**
+   * Append the encoded block to out, names must be lower case.
+   */
+  void encode(const HeaderList& headers, std::string& out);
+
+ private:
+  DynamicTable table_;
+  bool pendingSizeUpdate_;
+};
+
+/**
+ * Decode a Huffman coded string, return false if the code or the padding is invalid.
+ */
+bool huffmanDecode(const uint8_t* data, size_t size, std::string& out);
+
+/**
+ * Append the Huffman code of in to out.
+ */
+void huffmanEncode(const std::string& in, std::string& out);
+
+/**
+ * Return the length in bytes of the Huffman code of in.
+ */
+size_t huffmanLength(const std::string& in);
+
+/**
+ * Append an integer with a prefix of prefixBits bits, first holds the bits before the prefix.
+ */
+void encodeInteger(uint64_t value, uint8_t prefixBits, uint8_t first, std::string& out);
+
+/**
+ * Decode an integer with a prefix of prefixBits bits starting at data[pos],
+ * pos is moved after the integer. Return false if it's truncated or too large.
+ */
+bool decodeInteger(const uint8_t* data, size_t size, size_t& pos, uint8_t prefixBits,
+                   uint64_t& value);
+
+}  // namespace Hpack
+
+#endif  // _GROUP1_HPACK_H_
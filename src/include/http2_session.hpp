@@ -0,0 +1,199 @@
+/*
+ * MIT License
+ * Copyright (c) 2021 Yen Hao, Chen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GROUP1_HTTP2_SESSION_H_
+#define _GROUP1_HTTP2_SESSION_H_
+#include <boost/asio/buffer.hpp>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "include/CacheContent.hpp"
+#include "include/hpack.hpp"
+#include "include/http_utils.hpp"
+
+/**
+ * @brief
+ * Http2Session is the HTTP/2 (RFC 7540) framing layer of one connection, without any I/O.
+ * Connection passes the received bytes to feed(), and writes the frames returned by collect().
+ *
+ * Every request is handed to handler once its stream is half closed by the client,
+ * the response body is sent as DATA frames directly from the CacheContent.
+ * Streams which have DATA to send are served round robin, one frame each turn,
+ * so many files interleave fairly on one socket,
+ * and both the connection and the stream flow control windows of the peer are respected.
+ *
+ * Server push, priorities and request bodies are not supported,
+ * DATA sent by the client is acknowledged with WINDOW_UPDATE and dropped.
+ *
+ * @example use Http2Session
+ *
+ * @code
+ * Http2Session session([](const HttpUtils::HttpRequest& request) { return respond(request); });
+ * if (!session.feed(data, size)) closeAfterFlush();
+ * std::vector<boost::asio::const_buffer> buffers;
+ * if (session.collect(buffers, 65536) > 0) {
+ *   write(buffers);
+ *   session.consumed();
+ * }
+ */
+class Http2Session {
+ public:
+  /**
+   * The client connection preface, 24 bytes.
+   */
+  static const char PREFACE[];
+  static const size_t PREFACE_SIZE = 24;
+
+  struct Response {
+    /**
+     * state_, contentType_, contentLength_ and headers_ are sent in HEADERS,
+     * message_ is not used in HTTP/2.
+     */
+    HttpUtils::HttpResponse response;
+    CacheContent body;
+    /**
+     * Released when the stream is closed, Ex. a slot of admission controller.
+     */
+    std::shared_ptr<void> guard;
+  };
+  using Handler = std::function<Response(const HttpUtils::HttpRequest&)>;
+
+  Http2Session(Http2Session&) = delete;
+  Http2Session& operator=(Http2Session&) = delete;
+
+  /**
+   * The server SETTINGS frame is queued at once.
+   */
+  explicit Http2Session(Handler handler);
+
+  /**
+   * Start from an HTTP/1.1 request with "Upgrade: h2c", the request becomes stream 1.
+   * settings is the value of HTTP2-Settings header.
+   * Return false if settings is malformed.
+   */
+  bool upgrade(const HttpUtils::HttpRequest& request, const std::string& settings);
+
+  /**
+   * Process the bytes received, which begin with the connection preface.
+   * Return false on a connection error, a GOAWAY is queued and the connection
+   * should be closed after the output is written.
+   */
+  bool feed(const char* data, size_t size);
+
+  /**
+   * Append the buffers of frames ready to be sent, up to about limit bytes.
+   * Return the number of bytes, the buffers are valid until consumed() is called.
+   */
+  size_t collect(std::vector<boost::asio::const_buffer>& buffers, size_t limit);
+
+  /**
+   * Release the frames returned by the last collect(), call it after they are written.
+   */
+  void consumed();
+
+  /**
+   * Return true if GOAWAY was sent or received and there is nothing left to send.
+   */
+  bool closed() const;
+
+ private:
+  struct Stream {
+    HttpUtils::HttpRequest request;
+    Response response;
+    int64_t sendWindow = 0;
+    size_t sent = 0;
+    bool remoteClosed = false;
+    bool responding = false;
+    bool queued = false;
+  };
+
+  /**
+   * A frame to be written, bytes holds the frame header and the payload of control frames,
+   * DATA frames point into body.
+   */
+  struct Chunk {
+    std::string bytes;
+    CacheContent body;
+    const char* data = nullptr;
+    size_t size = 0;
+  };
+
+  void frame_(uint8_t type, uint8_t flags, uint32_t streamId, const std::string& payload);
+
+  /**
+   * Queue GOAWAY and stop processing input, always return false.
+   */
+  bool connectionError_(uint32_t code);
+
+  void resetStream_(uint32_t streamId, uint32_t code);
+
+  bool onFrame_(uint8_t type, uint8_t flags, uint32_t streamId, const uint8_t* payload,
+                uint32_t length);
+  bool onHeaders_(uint8_t flags, uint32_t streamId, const uint8_t* payload, uint32_t length);
+  bool onHeaderBlock_(uint32_t streamId, bool endStream);
+  bool onData_(uint8_t flags, uint32_t streamId, const uint8_t* payload, uint32_t length);
+  bool onSettings_(const uint8_t* payload, uint32_t length);
+  bool onWindowUpdate_(uint32_t streamId, const uint8_t* payload, uint32_t length);
+
+  /**
+   * Call handler for the request of stream, queue HEADERS and schedule DATA.
+   */
+  void respond_(uint32_t streamId, Stream& stream);
+
+  /**
+   * Put stream back into the round robin queue if it has data and window.
+   */
+  void schedule_(uint32_t streamId, Stream& stream);
+
+  Handler handler_;
+  Hpack::Decoder decoder_;
+  Hpack::Encoder encoder_;
+  std::map<uint32_t, Stream> streams_;
+
+  /* Streams which have DATA to send, served round robin */
+  std::deque<uint32_t> ready_;
+
+  std::deque<Chunk> control_;
+  std::deque<Chunk> inflight_;
+
+  /* Bytes of an incomplete frame */
+  std::string input_;
+  bool prefaceReceived_;
+
+  /* Header block split into HEADERS and CONTINUATION frames */
+  uint32_t continuationStream_;
+  bool continuationEndStream_;
+  std::string headerBlock_;
+
+  int64_t connectionWindow_;
+  int64_t peerInitialWindow_;
+  uint32_t peerMaxFrameSize_;
+  uint32_t lastStreamId_;
+  bool goaway_;
+};
+
+#endif  // _GROUP1_HTTP2_SESSION_H_
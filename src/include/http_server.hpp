@@ -23,10 +23,13 @@
 #ifndef _GROUP1_HTTP_SERVER_H_
 #define _GROUP1_HTTP_SERVER_H_
 #include <boost/asio.hpp>
+#include <chrono>
 #include <exception>
 #include <memory>
 
+#include "include/cache_warmer.hpp"
 #include "include/connection.hpp"
+#include "include/coro_connection.hpp"
 #include "include/thread_pool.hpp"
 
 /**
@@ -41,15 +44,48 @@ class HttpServer {
  public:
   HttpServer(std::string fileRoot, ushort port);
 
+  /**
+   * Same as above, context is passed to every accepted Connection.
+   */
+  HttpServer(std::string fileRoot, ushort port, std::shared_ptr<ServerContext> context);
+
+  /**
+   * Warm up the paths saved in listFile before start() listens, then count the requests
+   * and save the most requested paths to listFile every recordPeriod.
+   * start() listens once fraction (0 to 1) of the list is warmed, 0 listens at once
+   * and warms in the background. Must be called before start().
+   */
+  void warmUp(const std::string& listFile, double fraction, std::chrono::seconds recordPeriod);
+
+  /**
+   * Run the warm-up if any, then listen and serve until the io_context is stopped.
+   */
   void start();
 
  private:
+  /**
+   * Accept the next connection, with CoroConnection if context_->coroutines.
+   */
   void accept_();
 
+  /**
+   * Save the popularity list after recordPeriod_, and again every period.
+   */
+  void record_();
+
   std::string rootpath_;
   boost::filesystem::path workdir_;
   boost::asio::io_service &io_context_ = Connection::service;
   boost::asio::ip::tcp::acceptor acceptor_;
+  std::shared_ptr<ServerContext> context_;
+
+  std::string warmList_;
+  double warmFraction_ = 1;
+  std::chrono::seconds recordPeriod_{0};
+  std::unique_ptr<CacheWarmer> warmer_;
+  // warms the list, and writes it so the io_context never waits for the disk
+  std::unique_ptr<ThreadPool> warmPool_;
+  boost::asio::steady_timer recordTimer_;
 };
 
 #endif  // _GROUP1_HTTP_SERVER_H_
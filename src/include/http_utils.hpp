@@ -58,6 +58,16 @@ struct HttpRequest {
      */
     HttpRequest(std::string& request_str);
 
+    /**
+     * Create an empty request, fields are set by caller, Ex. from HTTP/2 HEADERS
+     */
+    HttpRequest();
+
+    /**
+     * Return the value of header name, case insensitive, or empty string if it's not found.
+     */
+    std::string header(const std::string& name) const;
+
     /**
      * parse request headers, then encapsulate in map container.
      */
@@ -96,9 +106,18 @@ struct HttpRequest {
  * auto response = HttpResponse();
  * response.setStatus(200).setMessage("OK").setContent(content);
  * sendResponse(response.stringify());
+ *
+ * // or send the content from another buffer
+ * response.setContentLength(file.size());
+ * sendResponse(response.stringifyHeader(), file);
  */
 struct HttpResponse {
 
+    /**
+     * Create a response with state 200, the file system is not touched.
+     */
+    HttpResponse();
+
     /**
      * Accept a filename as a parameter,
      * file system will look for the existence of the file and create a response.
@@ -120,11 +139,32 @@ struct HttpResponse {
      */
     struct HttpResponse& setContent(std::string& content);
 
+    /**
+     * Set http response content-type, default is "text/plain"
+     */
+    struct HttpResponse& setContentType(const std::string& contentType);
+
+    /**
+     * Set other http response header, name should be lower case
+     */
+    struct HttpResponse& setHeader(const std::string& name, const std::string& value);
+
+    /**
+     * Set content-length without setting content,
+     * used when the content is sent from another buffer after the header.
+     */
+    struct HttpResponse& setContentLength(size_t contentLength);
+
     /**
      * return http response format string
      */
     std::string stringify();
 
+    /**
+     * return status line and headers, ended with an empty line, without content
+     */
+    std::string stringifyHeader() const;
+
     /**
      * struct member, it save http state
      */
@@ -139,6 +179,21 @@ struct HttpResponse {
      * struct member, it save http content
      */
     std::string content_;
+
+    /**
+     * struct member, it save http content-length
+     */
+    size_t contentLength_ = 0;
+
+    /**
+     * struct member, it save http content-type
+     */
+    std::string contentType_ = "text/plain";
+
+    /**
+     * struct member, it save other http headers
+     */
+    std::map<std::string, std::string> headers_;
 };
 
 typedef struct HttpRequest HttpRequest;
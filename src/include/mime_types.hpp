@@ -0,0 +1,77 @@
+/*
+ * MIT License
+ * Copyright (c) 2021 Yen Hao, Chen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GROUP1_MIME_TYPES_H_
+#define _GROUP1_MIME_TYPES_H_
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief
+ * MimeTypes maps the extension of a file to its content-type.
+ * The built-in types are kept in a perfect hash table which is generated at compile time,
+ * so a lookup is one hash and one compare, and never allocates.
+ * A mime.types file can be loaded at startup, its entries take priority over the built-in ones.
+ *
+ * @example use MimeTypes
+ *
+ * @code
+ * MimeTypes mime;
+ * mime.load("/etc/mime.types");
+ * response.setContentType(mime.lookup("/www/index.html")); // "text/html"
+ */
+class MimeTypes {
+ public:
+  /**
+   * The type of a file whose extension is unknown.
+   */
+  static const char* const DEFAULT_TYPE;
+
+  MimeTypes() = default;
+
+  /**
+   * Load a mime.types style file, each line is "type ext1 ext2 ...",
+   * the type may have parameters, as in "text/html; charset=utf-8 html htm",
+   * text after '#' is ignored.
+   * Return false if the file can't be opened.
+   */
+  bool load(const std::string& filename);
+
+  /**
+   * Return the content-type of path, look up the loaded entries first, then the built-in table.
+   * The returned pointer is valid as long as this object.
+   */
+  const char* lookup(const std::string& path) const;
+
+  /**
+   * Look up the built-in table only.
+   */
+  static const char* lookupBuiltin(const std::string& path);
+
+ private:
+  /**
+   * Loaded entries, the key is lower case extension without the dot.
+   */
+  std::unordered_map<std::string, std::string> overrides_;
+};
+
+#endif  // _GROUP1_MIME_TYPES_H_
@@ -0,0 +1,102 @@
+/*
+ * MIT License
+ * Copyright (c) 2021 Yen Hao, Chen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GROUP1_POPULARITY_H_
+#define _GROUP1_POPULARITY_H_
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief
+ * Popularity counts the requests of every served path, and saves the most requested ones
+ * so the next start can warm them up before accepting connections.
+ *
+ * Counts are split into shards by the hash of the path like RateLimiter,
+ * only normalized paths of files that were found are recorded, so the map is bounded by the
+ * files of the root.
+ * Every save() halves the counts, a path that stopped being requested fades out of the list
+ * after a few periods.
+ *
+ * The file has one "<count> <path>" line per path, the most requested first.
+ *
+ * @example use Popularity
+ *
+ * @code
+ * Popularity popularity;
+ * popularity.record(request.pathname);
+ * popularity.save("popular.txt", 1000);
+ * auto paths = Popularity::load("popular.txt", 1000);
+ */
+class Popularity {
+ public:
+  Popularity(Popularity&) = delete;
+  Popularity& operator=(Popularity&) = delete;
+
+  /**
+   * shardSize is rounded up to a power of two.
+   */
+  explicit Popularity(size_t shardSize = 16);
+
+  /**
+   * Count one request of path.
+   */
+  void record(const std::string& path);
+
+  /**
+   * Write the limit most requested paths to file, which is replaced at once,
+   * then halve every count. Return false if the file can't be written,
+   * the counts are kept for the next save then.
+   */
+  bool save(const std::string& file, size_t limit);
+
+  /**
+   * Read at most limit paths saved by save(), the most requested first.
+   * Return an empty list if the file can't be read.
+   */
+  static std::vector<std::string> load(const std::string& file, size_t limit);
+
+  /**
+   * Return the count of path, used by tests.
+   */
+  uint64_t count(const std::string& path) const;
+
+ private:
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, uint64_t> counts;
+  };
+
+  Shard& shard_(const std::string& path) const;
+
+  /**
+   * Halve every count, and forget the paths whose count drops to 0.
+   */
+  void decay_();
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+#endif  // _GROUP1_POPULARITY_H_
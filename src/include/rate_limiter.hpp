@@ -0,0 +1,171 @@
+/*
+ * MIT License
+ * Copyright (c) 2021 Yen Hao, Chen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GROUP1_RATE_LIMITER_H_
+#define _GROUP1_RATE_LIMITER_H_
+#include <array>
+#include <atomic>
+#include <boost/asio/ip/address.hpp>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief
+ * RateLimiter keeps one token bucket per remote address.
+ * Every request takes one token, and tokens are refilled at `rate` per second
+ * up to `burst`. When a bucket is empty, acquire() returns how many seconds
+ * the client should wait, which is sent back as the Retry-After header.
+ *
+ * Buckets are split into several shards by the hash of the address,
+ * each shard owns its own mutex, so two io_context threads only contend
+ * when they serve clients that land in the same shard.
+ *
+ * @example use RateLimiter
+ *
+ * @code
+ * RateLimiter limiter(100, 200);
+ * auto retryAfter = limiter.acquire(socket.remote_endpoint().address());
+ * if (retryAfter > 0) reject(429, retryAfter);
+ */
+class RateLimiter {
+  using Clock = std::chrono::steady_clock;
+
+ public:
+  RateLimiter(RateLimiter&) = delete;
+  RateLimiter& operator=(RateLimiter&) = delete;
+
+  /**
+   * rate is the number of requests per second a client may send,
+   * burst is the size of the bucket. A rate of 0 disables the limiter.
+   * shardSize is rounded up to a power of two.
+   */
+  RateLimiter(double rate, double burst, size_t shardSize = 16);
+
+  /**
+   * Take one token from the bucket of address.
+   * Return 0 if the request is allowed, otherwise the number of seconds (at least 1)
+   * until a token will be available.
+   */
+  uint32_t acquire(const boost::asio::ip::address& address);
+
+  /**
+   * Same as above, but the current time is given by caller. Used by tests.
+   */
+  uint32_t acquire(const boost::asio::ip::address& address, Clock::time_point now);
+
+  /**
+   * Return the number of buckets which are tracked at present.
+   */
+  size_t size() const;
+
+ private:
+  using Key = std::array<unsigned char, 16>;
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+  struct Bucket {
+    double tokens;
+    Clock::time_point updated;
+  };
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<Key, Bucket, KeyHash> buckets;
+  };
+
+  /**
+   * Drop the buckets that would be full at `now`, those clients are idle
+   * and forgetting them is the same as keeping a full bucket.
+   * Called when a shard grows over the limit, so the map can't be grown by spoofed clients forever.
+   */
+  void sweep_(Shard& shard, Clock::time_point now);
+
+  double rate_;
+  double burst_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+/**
+ * @brief
+ * AdmissionController bounds how many requests are served at the same time.
+ * tryEnter() returns a Ticket, the slot is returned when the ticket is destroyed,
+ * so it can be captured by the callback of async_write.
+ *
+ * @example use AdmissionController
+ *
+ * @code
+ * AdmissionController admission(1024);
+ * auto ticket = admission.tryEnter();
+ * if (!ticket) reject(503);
+ */
+class AdmissionController {
+ public:
+  class Ticket {
+   public:
+    Ticket() : owner_(nullptr) {}
+    explicit Ticket(AdmissionController* owner) : owner_(owner) {}
+    Ticket(Ticket&& other) : owner_(other.owner_) { other.owner_ = nullptr; }
+    Ticket& operator=(Ticket&& other);
+    Ticket(const Ticket&) = delete;
+    Ticket& operator=(const Ticket&) = delete;
+    ~Ticket() { release(); }
+
+    explicit operator bool() const { return owner_ != nullptr; }
+
+    /**
+     * Give the slot back, safe to call more than once.
+     */
+    void release();
+
+   private:
+    AdmissionController* owner_;
+  };
+
+  AdmissionController(AdmissionController&) = delete;
+  AdmissionController& operator=(AdmissionController&) = delete;
+
+  /**
+   * maxInFlight of 0 means unlimited.
+   */
+  explicit AdmissionController(size_t maxInFlight);
+
+  /**
+   * Return an empty ticket if there are already maxInFlight requests.
+   */
+  Ticket tryEnter();
+
+  /**
+   * Return the number of requests in flight
+   */
+  size_t inFlight() const;
+
+ private:
+  size_t max_;
+  std::atomic<size_t> inFlight_;
+};
+
+#endif  //_GROUP1_RATE_LIMITER_H_
@@ -0,0 +1,227 @@
+/*
+ * MIT License
+ * Copyright (c) 2021 Yen Hao, Chen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GROUP1_REVERSE_PROXY_H_
+#define _GROUP1_REVERSE_PROXY_H_
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "include/body_framer.hpp"
+
+/**
+ * @brief
+ * ReverseProxy holds the parts of proxy mode which don't do I/O,
+ * Connection forwards a request to an upstream when its path matches a route,
+ * and streams both bodies through a fixed size buffer.
+ *
+ * @example use ReverseProxy
+ *
+ * @code
+ * ReverseProxy::Routes routes;
+ * routes.add("/api=127.0.0.1:8080");
+ * if (auto route = routes.match(request.pathname)) {
+ *   auto socket = pool.acquire(route->endpoint);
+ *   ...
+ *   pool.release(route->endpoint, std::move(socket));
+ * }
+ */
+namespace ReverseProxy {
+
+struct Route {
+  std::string prefix;
+  boost::asio::ip::tcp::endpoint endpoint;
+};
+
+/**
+ * @brief
+ * Path prefixes and their upstreams, the longest matching prefix wins.
+ * A prefix matches whole path segments, "/api" matches "/api" and "/api/users" but not "/apis".
+ */
+class Routes {
+ public:
+  /**
+   * Add a route from "prefix=host:port", host is resolved at once.
+   * Return false if spec is malformed or host can't be resolved.
+   */
+  bool add(const std::string& spec);
+
+  void add(const std::string& prefix, const boost::asio::ip::tcp::endpoint& endpoint);
+
+  /**
+   * Return the route of path, or nullptr if no prefix matches.
+   */
+  const Route* match(const std::string& path) const;
+
+  bool empty() const { return routes_.empty(); }
+
+ private:
+  /* Sorted by prefix length, longest first */
+  std::vector<Route> routes_;
+};
+
+/**
+ * @brief
+ * Idle keep-alive connections to upstreams.
+ * Every thread running the io_context has its own idle lists,
+ * so a connection is only reused by the thread which parked it, and acquire() and release()
+ * only lock to find the lists of the thread.
+ * A connection idle longer than idleTimeout, or closed by the upstream, is dropped.
+ *
+ * Sockets must be released to the pool before their io_context is destroyed,
+ * and the pool must be destroyed before the io_context.
+ */
+class UpstreamPool {
+ public:
+  using Socket = boost::asio::ip::tcp::socket;
+
+  explicit UpstreamPool(size_t maxIdle = 16,
+                        std::chrono::seconds idleTimeout = std::chrono::seconds(30));
+
+  UpstreamPool(UpstreamPool&) = delete;
+  UpstreamPool& operator=(UpstreamPool&) = delete;
+
+  /**
+   * Return an idle connection to endpoint, or nullptr if there is none.
+   */
+  std::unique_ptr<Socket> acquire(const boost::asio::ip::tcp::endpoint& endpoint);
+
+  /**
+   * Park a connection which has finished its response, the oldest one is closed
+   * when there are more than maxIdle connections to endpoint.
+   */
+  void release(const boost::asio::ip::tcp::endpoint& endpoint, std::unique_ptr<Socket> socket);
+
+  /**
+   * Number of idle connections to endpoint parked by the calling thread.
+   */
+  size_t idleCount(const boost::asio::ip::tcp::endpoint& endpoint);
+
+ private:
+  struct Idle {
+    std::unique_ptr<Socket> socket;
+    std::chrono::steady_clock::time_point since;
+  };
+  using Local = std::map<boost::asio::ip::tcp::endpoint, std::deque<Idle>>;
+
+  Local& local_();
+
+  size_t maxIdle_;
+  std::chrono::seconds idleTimeout_;
+  std::mutex mutex_;
+  std::unordered_map<std::thread::id, Local> locals_;
+};
+
+/**
+ * @brief
+ * State of one request forwarded by Connection.
+ */
+struct Exchange {
+  boost::asio::ip::tcp::endpoint endpoint;
+  std::unique_ptr<boost::asio::ip::tcp::socket> socket;
+
+  /**
+   * socket came from the pool, if it turns out closed before any response byte arrives,
+   * the request is sent again on a new connection, but only if it's replayable.
+   */
+  bool reused = false;
+
+  std::string method;
+
+  /**
+   * The request has an idempotent method and no body, sending it twice is harmless
+   * even if the upstream acted on the first one, RFC 7230 section 6.3.1.
+   */
+  bool replayable = false;
+
+  /**
+   * Forwarded request head, followed by the body bytes read together with the head.
+   */
+  std::string requestHead;
+  BodyFramer request;
+  bool requestDone = false;
+  bool requestPumped = false;
+
+  /**
+   * A write to the upstream is in flight. If the response ends before it completes,
+   * responseDone is set and the exchange is finished by the write handler,
+   * the socket can't be parked while it's being written.
+   */
+  bool requestWriting = false;
+  bool responseDone = false;
+
+  /**
+   * Response bytes until a whole head is received, and the body bytes received with it.
+   */
+  std::string responseHead;
+  std::string pending;
+  BodyFramer response;
+  bool responseStarted = false;
+  bool headForwarded = false;
+  bool keepAlive = false;
+  bool clientWriting = false;
+
+  /**
+   * Response body passes through this buffer.
+   */
+  std::unique_ptr<char[]> buffer;
+  size_t bufferSize = 0;
+};
+
+/**
+ * Return true if a request of method may be sent again, RFC 7231 section 4.2.2.
+ */
+bool idempotent(const std::string& method);
+
+/**
+ * Rewrite the request head received from the client, which ends with an empty line,
+ * into out for the upstream.
+ * Hop-by-hop headers are removed, the upstream connection is kept alive,
+ * and clientAddress is appended to X-Forwarded-For.
+ * body is reset to the framing of the request body.
+ * Return false if the head is malformed.
+ */
+bool forwardRequestHead(const std::string& head, const std::string& clientAddress,
+                        std::string& out, BodyFramer& body);
+
+/**
+ * Rewrite the response head received from the upstream into out for the client.
+ * method is the method of the request, status is set to the status code,
+ * keepAlive is set to false if the upstream connection can't be reused.
+ * body is reset to the framing of the response body, if the body ends when the upstream
+ * closes, "connection: close" is added and the client connection must be closed after it.
+ * Return false if the head is malformed.
+ */
+bool forwardResponseHead(const std::string& head, const std::string& method, std::string& out,
+                         BodyFramer& body, bool& keepAlive, unsigned& status);
+
+}  // namespace ReverseProxy
+
+#endif  // _GROUP1_REVERSE_PROXY_H_
@@ -0,0 +1,115 @@
+/*
+ * MIT License
+ * Copyright (c) 2021 Yen Hao, Chen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GROUP1_SERVER_CONTEXT_H_
+#define _GROUP1_SERVER_CONTEXT_H_
+#include <boost/asio/ssl.hpp>
+#include <ctime>
+#include <memory>
+
+#include "include/asset_bundle.hpp"
+#include "include/file_cache.hpp"
+#include "include/mime_types.hpp"
+#include "include/popularity.hpp"
+#include "include/rate_limiter.hpp"
+#include "include/reverse_proxy.hpp"
+
+/**
+ * @brief
+ * ServerContext collects the objects which are created once by HttpServer
+ * and shared by every Connection. A member left empty disables the feature.
+ *
+ * @example
+ *
+ * @code
+ * auto context = std::make_shared<ServerContext>();
+ * context->limiter = std::make_shared<RateLimiter>(100, 200);
+ * auto server = HttpServer(root, port, context);
+ */
+struct ServerContext {
+  /**
+   * Per client token bucket, a client over the limit gets 429.
+   */
+  std::shared_ptr<RateLimiter> limiter;
+
+  /**
+   * Global bound of requests in flight, a request over the bound gets 503.
+   */
+  std::shared_ptr<AdmissionController> admission;
+
+  /**
+   * Content-type table loaded at startup, the built-in table is used if it is empty.
+   */
+  std::shared_ptr<const MimeTypes> mime;
+
+  /**
+   * Content of small files, files larger than cache->maxObjectSize() are mapped on every request.
+   */
+  std::shared_ptr<FileCache> cache;
+
+  /**
+   * Seconds before a cached file is read again, 0 means never.
+   */
+  time_t cacheTtl = 60;
+
+  /**
+   * Files not smaller than this are mapped instead of read, used when there is no cache.
+   */
+  size_t mmapThreshold = 1 << 20;
+
+  /**
+   * If set, every connection does a TLS handshake before reading the request.
+   */
+  std::shared_ptr<boost::asio::ssl::context> tls;
+
+  /**
+   * Requests whose path matches a route are forwarded to the upstream instead of served
+   * from the root, upstreams keeps their connections alive, it may be empty.
+   */
+  std::shared_ptr<const ReverseProxy::Routes> routes;
+  std::shared_ptr<ReverseProxy::UpstreamPool> upstreams;
+
+  /**
+   * Largest body accepted by PUT and POST, which store it at the request path,
+   * 0 disables uploads.
+   */
+  uint64_t maxUploadSize = 0;
+
+  /**
+   * If set, files are served from the packed bundle instead of the root,
+   * with its ETags and gzip variants.
+   */
+  std::shared_ptr<const AssetBundle> bundle;
+
+  /**
+   * If true, HttpServer serves every connection with CoroConnection instead of Connection.
+   */
+  bool coroutines = false;
+
+  /**
+   * If set, every request of a file that is found is counted, HttpServer saves the most
+   * requested paths for the warm-up of the next start.
+   */
+  std::shared_ptr<Popularity> popularity;
+};
+
+#endif  // _GROUP1_SERVER_CONTEXT_H_
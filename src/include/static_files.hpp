@@ -0,0 +1,75 @@
+/*
+ * MIT License
+ * Copyright (c) 2021 Yen Hao, Chen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GROUP1_STATIC_FILES_H_
+#define _GROUP1_STATIC_FILES_H_
+#include <string>
+
+#include "include/CacheContent.hpp"
+#include "include/http_utils.hpp"
+#include "include/server_context.hpp"
+
+/**
+ * @brief
+ * StaticFiles answers a request from the files of the server, the file cache or the bundle,
+ * without touching the connection, so every connection handler sends the same responses.
+ *
+ * @example use StaticFiles
+ *
+ * @code
+ * HttpUtils::HttpResponse response;
+ * auto body = StaticFiles::respond(*context, request, response);
+ * send(response.stringifyHeader(), body);
+ */
+namespace StaticFiles {
+/**
+ * Look up the file of request, set status, content-type and content-length of response,
+ * and count the request in context.popularity if the file is found, under the normalized
+ * path so "/a.txt", "//a.txt" and "/./a.txt" are one entry.
+ * The returned content is the body, it's empty if there is no body.
+ */
+CacheContent respond(const ServerContext& context, const HttpUtils::HttpRequest& request,
+                     HttpUtils::HttpResponse& response);
+
+/**
+ * Same as respond(), the file is looked up in context.bundle. Answer 304 if If-None-Match
+ * has its ETag, and send the gzip variant if there is one and the client accepts it.
+ */
+CacheContent respondBundle(const ServerContext& context, const HttpUtils::HttpRequest& request,
+                           HttpUtils::HttpResponse& response);
+
+/**
+ * Look up path in the file cache, read or map the file if it's not cached.
+ * The returned content is not valid if the file can't be read.
+ */
+CacheContent load(const ServerContext& context, const std::string& path);
+
+/**
+ * Make the first request of pathname fast: put the file in context.cache without counting
+ * a miss, or only read it ahead into the page cache if there is no cache or the file is too
+ * large for it, or fault in its pages if files are served from context.bundle.
+ * Return false if there is no such file. Safe to call from any thread.
+ */
+bool warm(const ServerContext& context, const std::string& pathname);
+}  // namespace StaticFiles
+
+#endif  // _GROUP1_STATIC_FILES_H_
@@ -23,13 +23,17 @@
 #ifndef _GROUP1_THREAD_POOL_H_
 #define _GROUP1_THREAD_POOL_H_
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <deque>
+#include <exception>
 #include <functional>
 #include <future>
 #include <memory>
 #include <mutex>
+#include <stdexcept>
 #include <thread>
+#include <vector>
 
 /**
  * @brief
@@ -56,11 +60,96 @@
  *   result2.get();
  *   return 0;
  * }
+ *
+ * An elastic pool starts with minWorkers threads and lets a controller thread resize it:
+ *
+ * @code
+ * ThreadPool::Elastic options;
+ * options.minWorkers = 2;
+ * options.maxWorkers = 64;
+ * options.targetWait = std::chrono::milliseconds(5);
+ * ThreadPool pool(options);
  */
 class ThreadPool {
-  using Task = std::function<void()>;
+  /* Runs the job, or fails its future with the error when not null */
+  using Task = std::function<void(std::exception_ptr)>;
 
  public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * Priority classes, a worker takes the next job from the classes by smooth weighted
+   * round robin, so HIGH gets most of the workers without starving NORMAL and LOW.
+   */
+  enum class Priority { HIGH, NORMAL, LOW };
+
+  /**
+   * Shared flag of a job, cancel() from any thread before the job starts drops it.
+   * A default constructed token is never cancelled.
+   */
+  class CancelToken {
+   public:
+    CancelToken() = default;
+    static CancelToken create();
+    void cancel() const;
+    bool cancelled() const;
+
+   private:
+    explicit CancelToken(std::shared_ptr<std::atomic<bool>> flag);
+    std::shared_ptr<std::atomic<bool>> flag_;
+  };
+
+  /**
+   * How submit() queues a job.
+   */
+  struct Schedule {
+    Schedule(Priority priority = Priority::NORMAL,
+             Clock::time_point deadline = Clock::time_point::max(), CancelToken token = {})
+        : priority(priority), deadline(deadline), token(std::move(token)) {}
+
+    Priority priority;
+    Clock::time_point deadline;
+    CancelToken token;
+  };
+
+  /* Future of a job dropped because its deadline passed before it started */
+  struct Expired : std::runtime_error {
+    Expired() : std::runtime_error("Job deadline expired.") {}
+  };
+
+  /* Future of a job dropped because its token was cancelled before it started */
+  struct Cancelled : std::runtime_error {
+    Cancelled() : std::runtime_error("Job cancelled.") {}
+  };
+
+  /**
+   * Bounds and targets of an elastic pool.
+   * When a queued job has waited longer than targetWait and no worker is idle, workers are added,
+   * up to maxWorkers. A worker which stays idle for idleGrace retires, down to minWorkers.
+   */
+  struct Elastic {
+    uint16_t minWorkers = 1;
+    uint16_t maxWorkers = 64;
+    std::chrono::microseconds targetWait = std::chrono::milliseconds(10);
+    std::chrono::milliseconds idleGrace = std::chrono::seconds(30);
+  };
+
+  /**
+   * Wait-time (queued until picked by a worker) and run-time of the finished jobs,
+   * and how often an elastic pool has grown or shrunk, accumulated since construction.
+   */
+  struct Stats {
+    uint64_t completed = 0;
+    std::chrono::microseconds totalWait{0};
+    std::chrono::microseconds maxWait{0};
+    std::chrono::microseconds totalRun{0};
+    std::chrono::microseconds maxRun{0};
+    uint64_t grown = 0;
+    uint64_t retired = 0;
+    uint64_t expired = 0;
+    uint64_t cancelled = 0;
+  };
+
   ThreadPool(ThreadPool&) = delete;
   ThreadPool& operator=(ThreadPool&) = delete;
 
@@ -70,6 +159,12 @@ class ThreadPool {
    */
   explicit ThreadPool(uint16_t poolSize);
 
+  /**
+   * Elastic pool, starts options.minWorkers threads and a controller thread which
+   * adds or retires workers within [minWorkers, maxWorkers].
+   */
+  explicit ThreadPool(const Elastic& options);
+
   /**
    * When the ThreadPool object is deconstructed, make sure that each thread executes join() function.
    */
@@ -79,55 +174,48 @@ class ThreadPool {
    * Encapsulate the parameter as a Smart pointer of type Task through std::bind,
    * because it is not sure when the task will be completed, the future is used to encapsulate the return value.
    * The smart pointer is used to ensure that when the job is executed, it has not been recycled by the system.
-   * The encapsulated smart pointer will be "push" into jobs_, waiting for worker_ to take out and execute.
-   * Jobs created using dispatch follow the FIFO mode.
+   * The encapsulated smart pointer will be "push" into the queue of schedule.priority, waiting for worker_ to take out and execute.
+   * If schedule.token is cancelled or schedule.deadline has passed when a worker takes the job out,
+   * the job is dropped without running and its future throws Cancelled or Expired.
    */
   template <typename Fn, typename... Args>
-  auto dispatch(Fn&& func, Args&&... args) -> std::future<decltype(func(args...))> {
+  auto submit(const Schedule& schedule, Fn&& func, Args&&... args)
+      -> std::future<decltype(func(args...))> {
     if (!processing_.load()) throw std::runtime_error("Thread pool is stop running.");
     using FunctionType = decltype(func(args...));
-    using packaged_result_t = std::packaged_task<FunctionType()>;
+    using packaged_result_t = std::packaged_task<FunctionType(std::exception_ptr)>;
 
+    auto bound = std::bind(std::forward<Fn>(func), std::forward<Args>(args)...);
     auto task = std::make_shared<packaged_result_t>(
-      std::bind(std::forward<Fn>(func), std::forward<Args>(args)...)
+      [bound = std::move(bound)](std::exception_ptr error) mutable -> FunctionType {
+        if (error) std::rethrow_exception(error);
+        return bound();
+      }
     );
 
-    {
-      std::lock_guard<std::mutex> lock(mutex_);
-      jobs_.emplace_back([task]() {
-        (*task)();
-      });
-    }
-
-    cv_.notify_one();
+    push_([task](std::exception_ptr error) {
+      (*task)(error);
+    }, schedule);
     return task->get_future();
   }
 
+  /**
+   * Same as submit() with the NORMAL priority class and no deadline.
+   * Jobs created using dispatch follow the FIFO mode.
+   */
+  template <typename Fn, typename... Args>
+  auto dispatch(Fn&& func, Args&&... args) -> std::future<decltype(func(args...))> {
+    return submit(Schedule(Priority::NORMAL), std::forward<Fn>(func), std::forward<Args>(args)...);
+  }
+
   /**
    * Its function is similar to dispatch(),
-   * the difference is that dispatch uses emplace_back() to put the job,
-   * Execute uses emplace_front() to put the job.
+   * the difference is that execute puts the job into the HIGH priority class.
    * In other words, when a higher priority task is to be executed, you can use execute() to dispatch
    */
   template <typename Fn, typename... Args>
   auto execute(Fn&& func, Args&&... args) -> std::future<decltype(func(args...))> {
-    if (!processing_.load()) throw std::runtime_error("Thread pool is stop running.");
-    using FunctionType = decltype(func(args...));
-    using packaged_result_t = std::packaged_task<FunctionType()>;
-
-    auto task = std::make_shared<packaged_result_t>(
-      std::bind(std::forward<Fn>(func), std::forward<Args>(args)...)
-    );
-
-    {
-      std::lock_guard<std::mutex> lock(mutex_);
-      jobs_.emplace_front([task]() {
-        (*task)();
-      });
-    }
-
-    cv_.notify_one();
-    return task->get_future();
+    return submit(Schedule(Priority::HIGH), std::forward<Fn>(func), std::forward<Args>(args)...);
   }
 
   /**
@@ -147,7 +235,38 @@ class ThreadPool {
    */
   size_t avaliableWorkerSize() const;
 
+  /**
+   * Get the number of running worker threads, idle or not
+   */
+  size_t workerSize() const;
+
+  /**
+   * Snapshot of the wait-time and run-time statistics
+   */
+  Stats stats() const;
+
  private:
+  struct Job {
+    Task task;
+    Clock::time_point queued;
+    Clock::time_point deadline;
+    CancelToken token;
+  };
+
+  /**
+   * Put the job into the queue of its class with the time it was queued, and wake a worker.
+   */
+  void push_(Task task, const Schedule& schedule);
+
+  /**
+   * Take the next job out by smooth weighted round robin over the non-empty classes,
+   * mutex_ must be held and some class must have a job.
+   */
+  Job pop_();
+
+  /* Whether any class has a job, mutex_ must be held */
+  bool pending_() const;
+
   /**
    * In constructive execution, call this method.
    * If processing_ is true, Enter an infinite loop, each iteration will block the thread.
@@ -156,19 +275,35 @@ class ThreadPool {
    */
   void initThread();
 
+  /**
+   * Loop of the controller thread of an elastic pool. Every half targetWait, join retired workers,
+   * and add workers if the oldest queued job has waited longer than targetWait while none is idle.
+   */
+  void control_();
+
+  /* Start one more worker, mutex_ must be held */
+  void spawn_();
+
+  /* Join workers which have retired, mutex_ must be held */
+  void reap_();
+
   /* Thread queue, when dispatch or execute call, will be woken up, take out the elements of jobs_ and execute */
   std::deque<std::thread> workers_;
 
-  /* Work queue, when dispatch or execute call, put a Task */
-  std::deque<Task> jobs_;
+  /* Work queues, one for each Priority, when submit, dispatch or execute call, put a Job */
+  static const size_t PRIORITY_CLASSES = 3;
+  std::deque<Job> jobs_[PRIORITY_CLASSES];
+
+  /* Current weights of the smooth weighted round robin, guarded by mutex_ */
+  int credits_[PRIORITY_CLASSES] = {};
 
   /* Mutual exclusion lock, when the elements of jobs_ are put in or out, to ensure synchronization between threads */
-  std::mutex mutex_;
+  mutable std::mutex mutex_;
 
   /**
    * Conditional variables,
    * dispatch() or execute() will execute notify_one(), and deconstructed will call notify_all(),
-   * wait until notified, if the conditional `processing_ || !jobs_.empty()` is true Wake up thread;
+   * wait until notified, if the conditional `!processing_ || pending_()` is true Wake up thread;
    * Otherwise, continue to block the thread.
    */
   std::condition_variable cv_;
@@ -185,5 +320,22 @@ class ThreadPool {
    * If there is no job in jobs_, this value is equivalent to pool size
    */
   std::atomic<uint16_t> available_;
+
+  /* Whether the pool was built from Elastic options, its bounds and targets */
+  bool elastic_ = false;
+  Elastic options_;
+
+  /* Number of live workers, guarded by mutex_ */
+  size_t threads_ = 0;
+
+  /* Workers which have left initThread() and are waiting to be joined, guarded by mutex_ */
+  std::vector<std::thread::id> retired_;
+
+  /* Controller of an elastic pool, woken early by abort() */
+  std::thread controller_;
+  std::condition_variable controlCv_;
+
+  /* Guarded by mutex_ */
+  Stats stats_;
 };
 #endif  //_GROUP1_THREAD_POOL_H_
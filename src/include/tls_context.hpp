@@ -0,0 +1,57 @@
+/*
+ * MIT License
+ * Copyright (c) 2021 Yen Hao, Chen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GROUP1_TLS_CONTEXT_H_
+#define _GROUP1_TLS_CONTEXT_H_
+#include <boost/asio/ssl.hpp>
+#include <memory>
+#include <string>
+
+/**
+ * @brief
+ * Helpers to create the server side TLS context shared by every Connection.
+ *
+ * The context accepts TLS 1.2 and later, and keeps sessions on the server and
+ * issues session tickets, so a returning client can resume without a full handshake.
+ * Kernel TLS is not enabled: OpenSSL only hands the record layer to the kernel when it owns
+ * the socket BIO, and the asio engine works on memory BIOs.
+ *
+ * @example create TLS context
+ *
+ * @code
+ * auto context = std::make_shared<ServerContext>();
+ * context->tls = TlsContext::makeServerContext("server.crt", "server.key");
+ */
+namespace TlsContext {
+
+/**
+ * Load the PEM certificate chain and private key, throw boost::system::system_error
+ * if any of them can't be loaded.
+ * "h2" is offered in ALPN only if http2 is true, "http/1.1" is always offered.
+ */
+std::shared_ptr<boost::asio::ssl::context> makeServerContext(const std::string& certFile,
+                                                             const std::string& keyFile,
+                                                             bool http2 = true);
+
+}  // namespace TlsContext
+
+#endif  // _GROUP1_TLS_CONTEXT_H_
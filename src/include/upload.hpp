@@ -0,0 +1,115 @@
+/*
+ * MIT License
+ * Copyright (c) 2021 Yen Hao, Chen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GROUP1_UPLOAD_H_
+#define _GROUP1_UPLOAD_H_
+#include <sys/types.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * @brief
+ * Upload is the file side of a PUT or POST body. The body goes to a temp file in the
+ * directory of the target, which is renamed onto the target by commit(),
+ * so a reader never sees half of a file. The temp file is removed if it's not committed.
+ *
+ * With direct I/O the file is opened with O_DIRECT and written in aligned blocks from a
+ * fixed staging buffer, so a large upload doesn't push the page cache out.
+ * spliceFrom() moves bytes from a socket to the file through a pipe,
+ * without copying them to user space.
+ * Either way the memory used doesn't depend on the size of the body.
+ *
+ * @example use Upload
+ *
+ * @code
+ * auto upload = Upload::create("/srv/www/artifact.tar", true, contentLength);
+ * if (!upload) return serverError();
+ * while (receive(buffer, size)) upload->write(buffer, size);
+ * upload->commit();
+ */
+class Upload {
+ public:
+  /**
+   * Create the temp file for target. direct asks for O_DIRECT,
+   * it's silently dropped if the file system doesn't support it.
+   * expectedSize, if not 0, is reserved on disk at once.
+   * Return nullptr and keep errno if the file can't be created.
+   */
+  static std::unique_ptr<Upload> create(const std::string& target, bool direct,
+                                        uint64_t expectedSize);
+
+  Upload(Upload&) = delete;
+  Upload& operator=(Upload&) = delete;
+  ~Upload();
+
+  /**
+   * Append data to the file, return false on a write error.
+   */
+  bool write(const char* data, size_t size);
+
+  /**
+   * Move up to size bytes from fd to the file through a pipe.
+   * Return the bytes moved, 0 if fd reached EOF, or -1 with errno,
+   * EAGAIN means fd has nothing to read for now. Not available with direct I/O.
+   */
+  ssize_t spliceFrom(int fd, size_t size);
+
+  /**
+   * Write what is staged and rename the file onto the target, return false on error.
+   */
+  bool commit();
+
+  /**
+   * Bytes appended so far.
+   */
+  uint64_t size() const { return size_; }
+
+  bool direct() const { return direct_; }
+
+  const std::string& target() const { return target_; }
+
+ private:
+  Upload(int fd, std::string path, std::string target, bool direct);
+
+  /**
+   * Write the whole blocks of the staging buffer.
+   */
+  bool flush_(bool all);
+
+  int fd_;
+  std::string path_;
+  std::string target_;
+  bool direct_;
+  bool committed_;
+  uint64_t size_;
+
+  /* Aligned staging buffer for O_DIRECT */
+  std::unique_ptr<char, void (*)(void*)> staging_;
+  size_t staged_;
+
+  /* Pipe used by spliceFrom(), created on first use */
+  int pipe_[2];
+};
+
+#endif  // _GROUP1_UPLOAD_H_
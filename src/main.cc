@@ -1,21 +1,106 @@
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 
 #include "include/http_server.hpp"
+#include "include/tls_context.hpp"
 
 int main(int argc, char const *argv[]) {
   ushort port = -1;
   std::string root;
+  double rate = 0, burst = 0;
+  size_t maxInFlight = 0;
+  std::string mimeTypes;
+  size_t cacheSize = 0, cacheMaxObject = 0;
+  long cacheTtl = -1;
+  std::string certFile, keyFile;
+  auto routes = std::make_shared<ReverseProxy::Routes>();
+  uint64_t maxUpload = 0;
+  std::string bundleFile;
+  bool coroutines = false;
+  std::string warmList;
+  double warmFraction = 1;
+  long warmRecord = 60;
   for (int i = 1; i < argc; ++i) {
     if (strcmp(argv[i], "-d") == 0) {
       root = std::string(argv[i + 1]);
     } else if (strcmp(argv[i], "-p") == 0) {
       port = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--rate") == 0) {
+      rate = atof(argv[i + 1]);
+    } else if (strcmp(argv[i], "--burst") == 0) {
+      burst = atof(argv[i + 1]);
+    } else if (strcmp(argv[i], "--max-inflight") == 0) {
+      maxInFlight = atol(argv[i + 1]);
+    } else if (strcmp(argv[i], "--mime-types") == 0) {
+      mimeTypes = std::string(argv[i + 1]);
+    } else if (strcmp(argv[i], "--cache-size") == 0) {
+      cacheSize = atol(argv[i + 1]);
+    } else if (strcmp(argv[i], "--cache-max-object") == 0) {
+      cacheMaxObject = atol(argv[i + 1]);
+    } else if (strcmp(argv[i], "--cache-ttl") == 0) {
+      cacheTtl = atol(argv[i + 1]);
+    } else if (strcmp(argv[i], "--cert") == 0) {
+      certFile = std::string(argv[i + 1]);
+    } else if (strcmp(argv[i], "--key") == 0) {
+      keyFile = std::string(argv[i + 1]);
+    } else if (strcmp(argv[i], "--max-upload") == 0) {
+      maxUpload = strtoull(argv[i + 1], nullptr, 10);
+    } else if (strcmp(argv[i], "--bundle") == 0) {
+      bundleFile = std::string(argv[i + 1]);
+    } else if (strcmp(argv[i], "--coroutines") == 0) {
+      coroutines = true;
+    } else if (strcmp(argv[i], "--warm-list") == 0) {
+      warmList = std::string(argv[i + 1]);
+    } else if (strcmp(argv[i], "--warm-fraction") == 0) {
+      warmFraction = atof(argv[i + 1]);
+    } else if (strcmp(argv[i], "--warm-record") == 0) {
+      warmRecord = atol(argv[i + 1]);
+    } else if (strcmp(argv[i], "--proxy") == 0) {
+      if (!routes->add(argv[i + 1])) std::cerr << "Invalid route " << argv[i + 1] << "\n";
     }
   }
 
   std::cout << "Server running at port:" << port << " , serve ";
-  auto server = HttpServer(root, port);
+  auto context = std::make_shared<ServerContext>();
+  if (rate > 0) context->limiter = std::make_shared<RateLimiter>(rate, burst > 0 ? burst : rate);
+  if (maxInFlight > 0) context->admission = std::make_shared<AdmissionController>(maxInFlight);
+  if (!mimeTypes.empty()) {
+    auto mime = std::make_shared<MimeTypes>();
+    if (!mime->load(mimeTypes)) std::cerr << "Can't load " << mimeTypes << "\n";
+    context->mime = mime;
+  }
+  if (cacheSize > 0) context->cache = std::make_shared<FileCache>(cacheSize, cacheMaxObject);
+  if (cacheTtl >= 0) context->cacheTtl = cacheTtl;
+  context->maxUploadSize = maxUpload;
+  context->coroutines = coroutines;
+  if (coroutines && (!certFile.empty() || !routes->empty() || maxUpload > 0)) {
+    std::cerr << "--coroutines serves files only, TLS, proxy routes and uploads are ignored\n";
+  }
+  if (!bundleFile.empty()) {
+    std::string error;
+    context->bundle = AssetBundle::open(bundleFile, error);
+    if (!context->bundle) {
+      std::cerr << "Can't open bundle " << error << "\n";
+      return 1;
+    }
+  }
+  if (!routes->empty()) {
+    context->routes = routes;
+    context->upstreams = std::make_shared<ReverseProxy::UpstreamPool>();
+  }
+  if (!certFile.empty()) {
+    // proxied responses are only streamed over HTTP/1.1
+    context->tls = TlsContext::makeServerContext(certFile, keyFile.empty() ? certFile : keyFile,
+                                                 routes->empty());
+    std::cout << "(https) ";
+  }
+  // resolved before the server changes into the root
+  if (!warmList.empty()) warmList = boost::filesystem::absolute(warmList).string();
+  auto server = HttpServer(root, port, context);
+  if (!warmList.empty()) {
+    server.warmUp(warmList, warmFraction, std::chrono::seconds(std::max(warmRecord, 0L)));
+  }
   server.start();
 
   return 0;
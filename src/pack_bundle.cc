@@ -0,0 +1,39 @@
+#include <cstring>
+#include <iostream>
+
+#include "include/asset_bundle.hpp"
+
+/*
+ * Pack a document root into a bundle, which is served by "main --bundle OUTPUT".
+ * Usage: pack_bundle ROOT OUTPUT [--mime-types FILE]
+ */
+int main(int argc, char const *argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " ROOT OUTPUT [--mime-types FILE]\n";
+    return 2;
+  }
+  MimeTypes mime;
+  bool loaded = false;
+  for (int i = 3; i + 1 < argc; ++i) {
+    if (strcmp(argv[i], "--mime-types") == 0) {
+      if (!mime.load(argv[i + 1])) {
+        std::cerr << "Can't load " << argv[i + 1] << "\n";
+        return 1;
+      }
+      loaded = true;
+    }
+  }
+
+  std::string error;
+  if (!AssetBundle::pack(argv[1], argv[2], loaded ? &mime : nullptr, error)) {
+    std::cerr << error << "\n";
+    return 1;
+  }
+  auto bundle = AssetBundle::open(argv[2], error);
+  if (!bundle) {
+    std::cerr << error << "\n";
+    return 1;
+  }
+  std::cout << "Packed " << bundle->size() << " files into " << argv[2] << "\n";
+  return 0;
+}
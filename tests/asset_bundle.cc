@@ -0,0 +1,195 @@
+#include "include/asset_bundle.hpp"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "include/connection.hpp"
+
+namespace {
+/*
+ * Document root with a large text file, a small one in a directory and an empty one,
+ * one per test, ctest runs every test in its own process in parallel.
+ */
+std::string makeRoot(std::string& page) {
+  auto root = testing::TempDir() + "asset_bundle_" +
+              testing::UnitTest::GetInstance()->current_test_info()->name() + "_" +
+              std::to_string(getpid()) + "/";
+  boost::filesystem::remove_all(root);
+  boost::filesystem::create_directories(root + "css");
+  page.clear();
+  for (int i = 0; i < 1000; i++) page += "<p>paragraph " + std::to_string(i) + "</p>\n";
+  std::ofstream(root + "index.html") << page;
+  std::ofstream(root + "css/site.css") << "body{}";
+  std::ofstream(root + "empty.txt");
+  return root;
+}
+
+std::string gunzip(const char* data, size_t size) {
+  z_stream stream{};
+  inflateInit2(&stream, 15 + 16);
+  std::string out(1 << 20, '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream.avail_in = size;
+  stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+  stream.avail_out = out.size();
+  inflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  inflateEnd(&stream);
+  return out;
+}
+}  // namespace
+
+TEST(AssetBundleTest, PackAndFind) {
+  std::string page, error;
+  auto root = makeRoot(page);
+  auto output = testing::TempDir() + "asset_bundle_test.bundle";
+  ASSERT_TRUE(AssetBundle::pack(root, output, nullptr, error)) << error;
+  auto bundle = AssetBundle::open(output, error);
+  ASSERT_NE(bundle, nullptr) << error;
+  EXPECT_EQ(bundle->size(), 3);
+
+  AssetBundle::Asset index, css, empty;
+  ASSERT_TRUE(bundle->find("/index.html", index));
+  EXPECT_EQ(std::string(index.body, index.size), page);
+  EXPECT_STREQ(index.contentType, "text/html");
+  EXPECT_EQ(std::string(index.etag).size(), 18);
+  EXPECT_EQ(index.etag[0], '"');
+  EXPECT_STRNE(index.etag, index.gzipEtag);
+  ASSERT_NE(index.gzip, nullptr);
+  EXPECT_LT(index.gzipSize, index.size);
+  EXPECT_EQ(gunzip(index.gzip, index.gzipSize), page);
+
+  ASSERT_TRUE(bundle->find("/css/site.css", css));
+  EXPECT_EQ(std::string(css.body, css.size), "body{}");
+  EXPECT_STREQ(css.contentType, "text/css");
+  EXPECT_EQ(css.gzip, nullptr);
+  EXPECT_STRNE(css.etag, index.etag);
+
+  ASSERT_TRUE(bundle->find("/empty.txt", empty));
+  EXPECT_EQ(empty.size, 0);
+
+  EXPECT_FALSE(bundle->find("/missing.html", empty));
+  EXPECT_FALSE(bundle->find("index.html", empty));
+
+  /* a body of a page or more starts on a page, a smaller one doesn't cross a page */
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(index.body) % 4096, 0);
+  auto cssStart = reinterpret_cast<uintptr_t>(css.body);
+  EXPECT_EQ(cssStart / 4096, (cssStart + css.size - 1) / 4096);
+
+  /* packing the same root again gives the same ETags */
+  ASSERT_TRUE(AssetBundle::pack(root, output + "2", nullptr, error));
+  auto again = AssetBundle::open(output + "2", error);
+  AssetBundle::Asset other;
+  ASSERT_TRUE(again->find("/index.html", other));
+  EXPECT_STREQ(other.etag, index.etag);
+  std::remove((output + "2").c_str());
+  std::remove(output.c_str());
+  boost::filesystem::remove_all(root);
+}
+
+TEST(AssetBundleTest, Corrupted) {
+  std::string page, error;
+  auto root = makeRoot(page);
+  auto output = testing::TempDir() + "asset_bundle_corrupted.bundle";
+  ASSERT_TRUE(AssetBundle::pack(root, output, nullptr, error));
+  auto size = boost::filesystem::file_size(output);
+
+  /* flip the last byte, which is in a body */
+  {
+    std::fstream file(output, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekg(size - 1);
+    char c = file.get();
+    file.seekp(size - 1);
+    file.put(c ^ 1);
+  }
+  EXPECT_EQ(AssetBundle::open(output, error), nullptr);
+  EXPECT_NE(error.find("checksum"), std::string::npos);
+  EXPECT_NE(AssetBundle::open(output, error, false), nullptr);
+
+  boost::filesystem::resize_file(output, size - 1);
+  EXPECT_EQ(AssetBundle::open(output, error, false), nullptr);
+  EXPECT_EQ(AssetBundle::open(root + "index.html", error), nullptr);
+  EXPECT_EQ(AssetBundle::open(root + "missing", error), nullptr);
+  std::remove(output.c_str());
+  boost::filesystem::remove_all(root);
+}
+
+TEST(AssetBundleTest, Loopback) {
+  using boost::asio::ip::tcp;
+  std::string page, error;
+  auto root = makeRoot(page);
+  auto output = testing::TempDir() + "asset_bundle_loopback.bundle";
+  ASSERT_TRUE(AssetBundle::pack(root, output, nullptr, error));
+
+  auto context = std::make_shared<ServerContext>();
+  context->bundle = AssetBundle::open(output, error);
+  ASSERT_NE(context->bundle, nullptr);
+  AssetBundle::Asset index;
+  ASSERT_TRUE(context->bundle->find("/index.html", index));
+
+  boost::asio::io_context io;
+  tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+  std::function<void()> accept = [&] {
+    auto conn = std::make_shared<Connection>(io, context);
+    acceptor.async_accept(conn->socket(), [&, conn](boost::system::error_code ec) {
+      if (!ec) conn->start();
+      accept();
+    });
+  };
+  accept();
+  std::thread server([&] { io.run(); });
+
+  boost::asio::io_context clientIo;
+  tcp::socket socket(clientIo);
+  socket.connect(acceptor.local_endpoint());
+  auto get = [&](const std::string& request) {
+    boost::asio::write(socket, boost::asio::buffer(request));
+    std::string response;
+    auto end = boost::asio::read_until(socket, boost::asio::dynamic_buffer(response), "\r\n\r\n");
+    auto head = response.substr(0, end);
+    auto pos = head.find("content-length: ");
+    size_t length = std::stoul(head.substr(pos + 16));
+    if (head.compare(9, 3, "304") == 0) length = 0;
+    if (response.size() < end + length) {
+      boost::asio::read(socket, boost::asio::dynamic_buffer(response),
+                        boost::asio::transfer_exactly(end + length - response.size()));
+    }
+    return response;
+  };
+
+  auto response = get("GET /index.html HTTP/1.1\r\nHost: a\r\n\r\n");
+  EXPECT_EQ(response.substr(0, 15), "HTTP/1.1 200 OK");
+  EXPECT_NE(response.find("etag: " + std::string(index.etag)), std::string::npos);
+  EXPECT_NE(response.find("vary: accept-encoding"), std::string::npos);
+  EXPECT_EQ(response.find("content-encoding"), std::string::npos);
+  EXPECT_EQ(response.substr(response.find("\r\n\r\n") + 4), page);
+
+  response = get("GET /index.html HTTP/1.1\r\nHost: a\r\nAccept-Encoding: br, gzip\r\n\r\n");
+  EXPECT_NE(response.find("content-encoding: gzip"), std::string::npos);
+  EXPECT_NE(response.find("etag: " + std::string(index.gzipEtag)), std::string::npos);
+  auto body = response.substr(response.find("\r\n\r\n") + 4);
+  EXPECT_EQ(gunzip(body.data(), body.size()), page);
+
+  response = get("GET /index.html HTTP/1.1\r\nHost: a\r\nAccept-Encoding: gzip;q=0\r\n\r\n");
+  EXPECT_EQ(response.find("content-encoding"), std::string::npos);
+
+  response = get("GET /index.html HTTP/1.1\r\nHost: a\r\nIf-None-Match: " +
+                 std::string(index.etag) + "\r\n\r\n");
+  EXPECT_EQ(response.substr(0, 12), "HTTP/1.1 304");
+
+  response = get("GET /css/missing.css HTTP/1.1\r\nHost: a\r\n\r\n");
+  EXPECT_EQ(response.substr(0, 12), "HTTP/1.1 404");
+
+  io.stop();
+  server.join();
+  std::remove(output.c_str());
+  boost::filesystem::remove_all(root);
+}
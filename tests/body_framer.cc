@@ -0,0 +1,54 @@
+#include "include/body_framer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+TEST(BodyFramerTest, Chunked) {
+  std::string body = "4;ext=1\r\nWiki\r\n5\r\npedia\r\n0\r\nTrailer: x\r\n\r\n";
+  BodyFramer framer;
+  framer.reset(BodyFramer::Mode::CHUNKED);
+  /* byte by byte */
+  for (size_t i = 0; i < body.size(); i++) {
+    EXPECT_FALSE(framer.done());
+    EXPECT_EQ(framer.consume(&body[i], 1), 1);
+  }
+  EXPECT_TRUE(framer.done());
+
+  /* the next message is not consumed */
+  framer.reset(BodyFramer::Mode::CHUNKED);
+  auto pipelined = body + "GET / HTTP/1.1\r\n";
+  EXPECT_EQ(framer.consume(pipelined.data(), pipelined.size()), body.size());
+  EXPECT_TRUE(framer.done());
+
+  framer.reset(BodyFramer::Mode::CHUNKED);
+  std::string invalid = "zz\r\n";
+  framer.consume(invalid.data(), invalid.size());
+  EXPECT_TRUE(framer.error());
+
+  framer.reset(BodyFramer::Mode::LENGTH, 3);
+  EXPECT_EQ(framer.consume("abcdef", 6), 3);
+  EXPECT_TRUE(framer.done());
+}
+
+TEST(BodyFramerTest, Decode) {
+  std::string body = "4\r\nWiki\r\n5;a=b\r\npedia\r\n0\r\n\r\nnext";
+  BodyFramer framer;
+  framer.reset(BodyFramer::Mode::CHUNKED);
+
+  /* split in the middle of a chunk */
+  std::string first = body.substr(0, 12), second = body.substr(12);
+  size_t payload = 0;
+  EXPECT_EQ(framer.decode(&first[0], first.size(), payload), first.size());
+  auto decoded = first.substr(0, payload);
+  EXPECT_EQ(framer.decode(&second[0], second.size(), payload), second.size() - 4);
+  decoded += second.substr(0, payload);
+  EXPECT_EQ(decoded, "Wikipedia");
+  EXPECT_TRUE(framer.done());
+
+  std::string plain = "abcdef";
+  framer.reset(BodyFramer::Mode::LENGTH, 4);
+  EXPECT_EQ(framer.decode(&plain[0], plain.size(), payload), 4);
+  EXPECT_EQ(payload, 4);
+  EXPECT_EQ(framer.remaining(), 0);
+}
@@ -0,0 +1,112 @@
+#include "include/cache_warmer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "include/static_files.hpp"
+
+TEST(CacheWarmerTest, Popularity) {
+  Popularity popularity(4);
+  for (int i = 0; i < 5; i++) popularity.record("/a.html");
+  for (int i = 0; i < 3; i++) popularity.record("/b.css");
+  popularity.record("/c.js");
+  EXPECT_EQ(popularity.count("/b.css"), 3);
+
+  auto file = testing::TempDir() + "popularity.txt";
+  ASSERT_TRUE(popularity.save(file, 2));
+  EXPECT_EQ(Popularity::load(file, 10), (std::vector<std::string>{"/a.html", "/b.css"}));
+  EXPECT_EQ(Popularity::load(file, 1), (std::vector<std::string>{"/a.html"}));
+
+  /* counts are halved by every save, a path requested once is forgotten */
+  EXPECT_EQ(popularity.count("/a.html"), 2);
+  EXPECT_EQ(popularity.count("/c.js"), 0);
+  for (int i = 0; i < 3; i++) popularity.record("/c.js");
+  ASSERT_TRUE(popularity.save(file, 10));
+  EXPECT_EQ(Popularity::load(file, 10),
+            (std::vector<std::string>{"/c.js", "/a.html", "/b.css"}));
+
+  std::remove(file.c_str());
+  EXPECT_TRUE(Popularity::load(file, 10).empty());
+
+  /* a failed save keeps the counts */
+  auto counted = popularity.count("/c.js");
+  EXPECT_FALSE(popularity.save(testing::TempDir() + "missing/popularity.txt", 10));
+  EXPECT_EQ(popularity.count("/c.js"), counted);
+}
+
+TEST(CacheWarmerTest, WarmUp) {
+  auto dir = testing::TempDir();
+  boost::filesystem::current_path(dir);
+  std::ofstream(dir + "warm_a.txt") << "aaa";
+  std::ofstream(dir + "warm_b.txt") << "bbb";
+  std::ofstream(dir + "warm_large.txt") << std::string(2000, 'l');
+
+  auto context = std::make_shared<ServerContext>();
+  context->cache = std::make_shared<FileCache>(1 << 20, 1000);
+  context->popularity = std::make_shared<Popularity>();
+  ThreadPool pool(4);
+  CacheWarmer warmer(context,
+                     {"/warm_a.txt", "/warm_missing.txt", "/warm_b.txt", "/warm_large.txt"});
+  EXPECT_EQ(warmer.total(), 4);
+  auto deadline = ThreadPool::Clock::now() + std::chrono::seconds(10);
+  warmer.start(pool, deadline);
+  ASSERT_TRUE(warmer.wait(1, deadline));
+  EXPECT_EQ(warmer.done(), 4);
+  /* the large file is only read ahead */
+  EXPECT_EQ(warmer.warmed(), 3);
+  EXPECT_EQ(context->cache->stats().entries, 2);
+
+  /* the warm-up is not counted as misses */
+  auto stats = context->cache->stats();
+  for (size_t i = 0; i < FileCache::SIZE_CLASSES; i++) EXPECT_EQ(stats.misses[i], 0);
+
+  CacheContent file;
+  EXPECT_TRUE(context->cache->find((boost::filesystem::current_path() / "warm_a.txt").string(),
+                                   file));
+  EXPECT_EQ(file.size(), 3);
+
+  /* the first request is a hit, and is counted for the next warm-up */
+  HttpUtils::HttpRequest request;
+  request.pathname = "/warm_b.txt";
+  HttpUtils::HttpResponse response;
+  auto hits = context->cache->stats().hits;
+  EXPECT_TRUE(StaticFiles::respond(*context, request, response).isValid());
+  EXPECT_NE(context->cache->stats().hits, hits);
+  EXPECT_EQ(context->popularity->count("/warm_b.txt"), 1);
+  request.pathname = "/warm_missing.txt";
+  StaticFiles::respond(*context, request, response);
+  EXPECT_EQ(context->popularity->count("/warm_missing.txt"), 0);
+
+  /* aliases of the same file are counted as one path */
+  for (auto alias : {"//warm_b.txt", "/./warm_b.txt", "/.//./warm_b.txt"}) {
+    request.pathname = alias;
+    EXPECT_TRUE(StaticFiles::respond(*context, request, response).isValid()) << alias;
+  }
+  EXPECT_EQ(context->popularity->count("/warm_b.txt"), 4);
+  auto list = dir + "warm_aliases.txt";
+  ASSERT_TRUE(context->popularity->save(list, 10));
+  EXPECT_EQ(Popularity::load(list, 10), std::vector<std::string>{"/warm_b.txt"});
+  std::remove(list.c_str());
+
+  /* past the deadline the jobs only count themselves done */
+  CacheWarmer late(context, {"/warm_a.txt", "/warm_b.txt"});
+  late.start(pool, ThreadPool::Clock::now() - std::chrono::seconds(1));
+  EXPECT_TRUE(late.wait(1, ThreadPool::Clock::now() + std::chrono::seconds(10)));
+  EXPECT_EQ(late.warmed(), 0);
+
+  /* an empty list is ready at once, a list never started is not ready by the deadline */
+  CacheWarmer empty(context, {});
+  EXPECT_TRUE(empty.wait(1, ThreadPool::Clock::now()));
+  EXPECT_TRUE(empty.wait(0, ThreadPool::Clock::now()));
+  CacheWarmer idle(context, {"/warm_a.txt"});
+  EXPECT_FALSE(idle.wait(0.5, ThreadPool::Clock::now() + std::chrono::milliseconds(20)));
+
+  std::remove((dir + "warm_a.txt").c_str());
+  std::remove((dir + "warm_b.txt").c_str());
+  std::remove((dir + "warm_large.txt").c_str());
+}
@@ -0,0 +1,125 @@
+#include "include/coro_connection.hpp"
+
+#include <gtest/gtest.h>
+
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using boost::asio::ip::tcp;
+
+namespace {
+/* Read one response, its body is content-length bytes */
+std::string readResponse(tcp::socket& socket, std::string& input) {
+  auto end = boost::asio::read_until(socket, boost::asio::dynamic_buffer(input), "\r\n\r\n");
+  auto pos = input.find("content-length: ");
+  size_t length = std::stoul(input.substr(pos + 16));
+  if (input.size() < end + length) {
+    boost::asio::read(socket, boost::asio::dynamic_buffer(input),
+                      boost::asio::transfer_exactly(end + length - input.size()));
+  }
+  auto response = input.substr(0, end + length);
+  input.erase(0, end + length);
+  return response;
+}
+}  // namespace
+
+TEST(CoroConnectionTest, KeepAlive) {
+  auto dir = testing::TempDir();
+  std::ofstream(dir + "coro_connection.txt") << "coroutine";
+  boost::filesystem::current_path(dir);
+
+  auto context = std::make_shared<ServerContext>();
+  boost::asio::io_context io;
+  tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+  std::vector<std::shared_ptr<CoroConnection>> connections;
+  std::function<void()> accept = [&] {
+    auto conn = std::make_shared<CoroConnection>(io, context);
+    acceptor.async_accept(conn->socket(), [&, conn](boost::system::error_code ec) {
+      if (ec) return;
+      connections.push_back(conn);
+      conn->start();
+      accept();
+    });
+  };
+  accept();
+  std::thread server([&] { io.run(); });
+
+  boost::asio::io_context clientIo;
+  tcp::socket socket(clientIo);
+  socket.connect(acceptor.local_endpoint());
+  std::string input;
+
+  /* several requests on one connection, two of them pipelined in one write */
+  for (int i = 0; i < 3; i++) {
+    boost::asio::write(socket, boost::asio::buffer(std::string(
+                                   "GET /coro_connection.txt HTTP/1.1\r\nHost: a\r\n\r\n")));
+    auto response = readResponse(socket, input);
+    EXPECT_EQ(response.substr(0, 15), "HTTP/1.1 200 OK");
+    EXPECT_EQ(response.substr(response.size() - 9), "coroutine");
+  }
+  boost::asio::write(socket, boost::asio::buffer(std::string(
+                                 "GET /missing.txt HTTP/1.1\r\nHost: a\r\n\r\n"
+                                 "GET /coro_connection.txt HTTP/1.1\r\nHost: a\r\n\r\n")));
+  EXPECT_EQ(readResponse(socket, input).substr(0, 12), "HTTP/1.1 404");
+  EXPECT_EQ(readResponse(socket, input).substr(0, 15), "HTTP/1.1 200 OK");
+
+  /* the server closes after a response to "Connection: close" */
+  boost::asio::write(socket, boost::asio::buffer(std::string(
+                                 "GET /coro_connection.txt HTTP/1.1\r\n"
+                                 "Connection: close\r\n\r\n")));
+  auto response = readResponse(socket, input);
+  EXPECT_NE(response.find("connection: close"), std::string::npos);
+  boost::system::error_code ec;
+  char byte;
+  boost::asio::read(socket, boost::asio::buffer(&byte, 1), ec);
+  EXPECT_EQ(ec, boost::asio::error::eof);
+
+  io.stop();
+  server.join();
+
+  /*
+   * every read and write took its handler from the memory of the connection,
+   * the 6 requests took at least one read and one write each
+   */
+  ASSERT_EQ(connections.size(), 1);
+  auto& memory = connections[0]->handlerMemory();
+  EXPECT_GE(memory.allocations(), 2 * 6);
+  EXPECT_EQ(memory.fallbacks(), 0);
+  std::remove((dir + "coro_connection.txt").c_str());
+}
+
+TEST(CoroConnectionTest, Admission) {
+  auto context = std::make_shared<ServerContext>();
+  context->limiter = std::make_shared<RateLimiter>(0.001, 1);
+  boost::asio::io_context io;
+  tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+  std::function<void()> accept = [&] {
+    auto conn = std::make_shared<CoroConnection>(io, context);
+    acceptor.async_accept(conn->socket(), [&, conn](boost::system::error_code ec) {
+      if (ec) return;
+      conn->start();
+      accept();
+    });
+  };
+  accept();
+  std::thread server([&] { io.run(); });
+
+  boost::asio::io_context clientIo;
+  tcp::socket socket(clientIo);
+  socket.connect(acceptor.local_endpoint());
+  std::string input;
+  boost::asio::write(socket, boost::asio::buffer(std::string(
+                                 "GET /a HTTP/1.1\r\n\r\nGET /a HTTP/1.1\r\n\r\n")));
+  EXPECT_EQ(readResponse(socket, input).substr(0, 12), "HTTP/1.1 404");
+  auto response = readResponse(socket, input);
+  EXPECT_EQ(response.substr(0, 12), "HTTP/1.1 429");
+  EXPECT_NE(response.find("retry-after: "), std::string::npos);
+
+  io.stop();
+  server.join();
+}
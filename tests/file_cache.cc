@@ -0,0 +1,106 @@
+#include "include/file_cache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace {
+std::string writeFile(const std::string& name, size_t size) {
+  auto path = testing::TempDir() + name;
+  std::ofstream file(path, std::ios::binary);
+  file << std::string(size, 'x');
+  return path;
+}
+}  // namespace
+
+TEST(CacheContentTest, FromFile) {
+  auto path = writeFile("cache_content_small", 100);
+  auto cc = CacheContent::fromFile(path, 1 << 20, 0, "text/plain");
+  EXPECT_TRUE(cc.isValid());
+  EXPECT_FALSE(cc.isMapped());
+  EXPECT_EQ(cc.size(), 100);
+  EXPECT_EQ(cc.getContent(), std::string(100, 'x'));
+
+  auto mapped = CacheContent::fromFile(path, 10, 0, "text/plain");
+  EXPECT_TRUE(mapped.isValid());
+  EXPECT_TRUE(mapped.isMapped());
+  EXPECT_EQ(std::string(mapped.data(), mapped.size()), std::string(100, 'x'));
+
+  EXPECT_FALSE(CacheContent::fromFile(path + ".missing", 10, 0, "text/plain").isValid());
+  EXPECT_FALSE(CacheContent::fromFile(testing::TempDir(), 10, 0, "text/plain").isValid());
+  std::remove(path.c_str());
+}
+
+TEST(FileCacheTest, Budget) {
+  /* one shard of 1000 bytes */
+  FileCache cache(1000, 400, 1);
+  auto path = writeFile("file_cache_300", 300);
+  auto cc = CacheContent::fromFile(path, 1 << 20, 0, "text/plain");
+
+  EXPECT_TRUE(cache.put("a", cc));
+  EXPECT_TRUE(cache.put("b", cc));
+  EXPECT_TRUE(cache.put("c", cc));
+  EXPECT_TRUE(cache.put("d", cc));
+
+  auto stats = cache.stats();
+  EXPECT_EQ(stats.entries, 3);
+  EXPECT_EQ(stats.bytes, 900);
+  EXPECT_EQ(stats.evictions[0], 1);
+
+  CacheContent result;
+  EXPECT_FALSE(cache.find("a", result));
+  EXPECT_TRUE(cache.find("d", result));
+  EXPECT_EQ(result.size(), 300);
+
+  /* larger than max object size */
+  auto large = writeFile("file_cache_500", 500);
+  EXPECT_FALSE(cache.put("e", CacheContent::fromFile(large, 1 << 20, 0, "text/plain")));
+  std::remove(path.c_str());
+  std::remove(large.c_str());
+}
+
+TEST(FileCacheTest, ScanResistant) {
+  FileCache cache(1000, 200, 1);
+  auto path = writeFile("file_cache_100", 100);
+  auto cc = CacheContent::fromFile(path, 1 << 20, 0, "text/plain");
+  CacheContent result;
+
+  /* hot files are hit twice and promoted */
+  for (auto hot : {"hot1", "hot2", "hot3"}) {
+    cache.put(hot, cc);
+    EXPECT_TRUE(cache.find(hot, result));
+  }
+
+  /* a scan of files read only once */
+  for (int i = 0; i < 50; ++i) {
+    cache.put("scan" + std::to_string(i), cc);
+  }
+
+  for (auto hot : {"hot1", "hot2", "hot3"}) {
+    EXPECT_TRUE(cache.find(hot, result));
+  }
+  auto stats = cache.stats();
+  EXPECT_EQ(stats.hits[0], 6);
+  EXPECT_GT(stats.hitRatio(0), 0);
+  std::remove(path.c_str());
+}
+
+TEST(FileCacheTest, Prefill) {
+  FileCache cache(1000, 200, 1);
+  auto path = writeFile("file_cache_prefill", 100);
+  auto cc = CacheContent::fromFile(path, 1 << 20, 0, "text/plain");
+
+  EXPECT_TRUE(cache.prefill("a", cc));
+  EXPECT_TRUE(cache.prefill("a", cc));
+  EXPECT_FALSE(cache.prefill("b", CacheContent()));
+  auto stats = cache.stats();
+  EXPECT_EQ(stats.entries, 1);
+  EXPECT_EQ(stats.misses[0], 0);
+
+  CacheContent result;
+  EXPECT_TRUE(cache.find("a", result));
+  EXPECT_EQ(cache.stats().hits[0], 1);
+  std::remove(path.c_str());
+}
@@ -0,0 +1,110 @@
+#include "include/hpack.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+std::string fromHex(const std::string& hex) {
+  std::string bytes;
+  for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+    bytes.push_back(static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+  }
+  return bytes;
+}
+
+bool decode(Hpack::Decoder& decoder, const std::string& block, Hpack::HeaderList& headers) {
+  headers.clear();
+  return decoder.decode(reinterpret_cast<const uint8_t*>(block.data()), block.size(), headers);
+}
+}  // namespace
+
+TEST(HpackTest, Integer) {
+  /* RFC 7541 C.1 */
+  std::string out;
+  Hpack::encodeInteger(10, 5, 0, out);
+  EXPECT_EQ(out, fromHex("0a"));
+  out.clear();
+  Hpack::encodeInteger(1337, 5, 0, out);
+  EXPECT_EQ(out, fromHex("1f9a0a"));
+
+  size_t pos = 0;
+  uint64_t value = 0;
+  ASSERT_TRUE(Hpack::decodeInteger(reinterpret_cast<const uint8_t*>(out.data()), out.size(), pos,
+                                   5, value));
+  EXPECT_EQ(value, 1337);
+  EXPECT_EQ(pos, 3);
+
+  pos = 0;
+  EXPECT_FALSE(Hpack::decodeInteger(reinterpret_cast<const uint8_t*>(out.data()), 2, pos, 5,
+                                    value));
+}
+
+TEST(HpackTest, Huffman) {
+  std::string out;
+  Hpack::huffmanEncode("www.example.com", out);
+  EXPECT_EQ(out, fromHex("f1e3c2e5f23a6ba0ab90f4ff"));
+  EXPECT_EQ(Hpack::huffmanLength("www.example.com"), out.size());
+
+  std::string decoded;
+  ASSERT_TRUE(Hpack::huffmanDecode(reinterpret_cast<const uint8_t*>(out.data()), out.size(),
+                                   decoded));
+  EXPECT_EQ(decoded, "www.example.com");
+
+  /* padding longer than 7 bits */
+  auto invalid = fromHex("ffff");
+  EXPECT_FALSE(Hpack::huffmanDecode(reinterpret_cast<const uint8_t*>(invalid.data()),
+                                    invalid.size(), decoded));
+}
+
+TEST(HpackTest, DecodeRequests) {
+  /* RFC 7541 C.4.1 and C.4.2, the second block refers to the dynamic table */
+  Hpack::Decoder decoder;
+  Hpack::HeaderList headers;
+  ASSERT_TRUE(decode(decoder, fromHex("828684418cf1e3c2e5f23a6ba0ab90f4ff"), headers));
+  Hpack::HeaderList expected = {{":method", "GET"},
+                                {":scheme", "http"},
+                                {":path", "/"},
+                                {":authority", "www.example.com"}};
+  EXPECT_EQ(headers, expected);
+
+  ASSERT_TRUE(decode(decoder, fromHex("828684be5886a8eb10649cbf"), headers));
+  expected.emplace_back("cache-control", "no-cache");
+  EXPECT_EQ(headers, expected);
+
+  /* C.3.1 without Huffman code */
+  Hpack::Decoder plain;
+  ASSERT_TRUE(decode(plain, fromHex("828684410f7777772e6578616d706c652e636f6d"), headers));
+  EXPECT_EQ(headers[3], Hpack::Header(":authority", "www.example.com"));
+
+  /* index out of range */
+  EXPECT_FALSE(decode(plain, fromHex("ff00"), headers));
+}
+
+TEST(HpackTest, RoundTrip) {
+  Hpack::Encoder encoder;
+  Hpack::Decoder decoder;
+  Hpack::HeaderList headers = {{":status", "200"},
+                               {"content-type", "text/html"},
+                               {"content-length", "1234"},
+                               {"x-custom", "some value"}};
+  for (int i = 0; i < 3; i++) {
+    std::string block;
+    encoder.encode(headers, block);
+    Hpack::HeaderList decoded;
+    ASSERT_TRUE(decode(decoder, block, decoded));
+    EXPECT_EQ(decoded, headers);
+    /* the repeated block is mostly indexed */
+    if (i > 0) {
+      EXPECT_LT(block.size(), 12);
+    }
+  }
+
+  /* the peer shrinks the table */
+  encoder.setMaxTableSize(0);
+  std::string block;
+  encoder.encode(headers, block);
+  Hpack::HeaderList decoded;
+  ASSERT_TRUE(decode(decoder, block, decoded));
+  EXPECT_EQ(decoded, headers);
+}
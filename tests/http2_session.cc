@@ -0,0 +1,236 @@
+#include "include/http2_session.hpp"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+struct Frame {
+  uint8_t type;
+  uint8_t flags;
+  uint32_t streamId;
+  std::string payload;
+};
+
+std::string frame(uint8_t type, uint8_t flags, uint32_t streamId, const std::string& payload) {
+  std::string bytes;
+  bytes.push_back(static_cast<char>(payload.size() >> 16));
+  bytes.push_back(static_cast<char>(payload.size() >> 8));
+  bytes.push_back(static_cast<char>(payload.size()));
+  bytes.push_back(static_cast<char>(type));
+  bytes.push_back(static_cast<char>(flags));
+  for (int shift = 24; shift >= 0; shift -= 8) bytes.push_back(static_cast<char>(streamId >> shift));
+  return bytes + payload;
+}
+
+std::string u32(uint32_t value) {
+  std::string bytes;
+  for (int shift = 24; shift >= 0; shift -= 8) bytes.push_back(static_cast<char>(value >> shift));
+  return bytes;
+}
+
+std::string request(Hpack::Encoder& encoder, uint32_t streamId, const std::string& path) {
+  std::string block;
+  encoder.encode({{":method", "GET"}, {":scheme", "http"}, {":path", path}, {":authority", "x"}},
+                 block);
+  /* END_STREAM | END_HEADERS */
+  return frame(0x1, 0x5, streamId, block);
+}
+
+/* Collect everything and split it into frames */
+std::vector<Frame> output(Http2Session& session) {
+  std::vector<boost::asio::const_buffer> buffers;
+  session.collect(buffers, 1 << 20);
+  std::string bytes;
+  for (auto& buffer : buffers) bytes.append(static_cast<const char*>(buffer.data()), buffer.size());
+  session.consumed();
+
+  std::vector<Frame> frames;
+  size_t pos = 0;
+  while (pos + 9 <= bytes.size()) {
+    auto p = reinterpret_cast<const uint8_t*>(bytes.data() + pos);
+    uint32_t length = (p[0] << 16) | (p[1] << 8) | p[2];
+    uint32_t streamId = ((p[5] & 0x7f) << 24) | (p[6] << 16) | (p[7] << 8) | p[8];
+    frames.push_back({p[3], p[4], streamId, bytes.substr(pos + 9, length)});
+    pos += 9 + length;
+  }
+  EXPECT_EQ(pos, bytes.size());
+  return frames;
+}
+
+class Http2SessionTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    // ctest runs every test in its own process, in parallel
+    path_ = testing::TempDir() + "http2_session_body_" +
+            testing::UnitTest::GetInstance()->current_test_info()->name() + "_" +
+            std::to_string(getpid());
+    std::ofstream file(path_, std::ios::binary);
+    for (int i = 0; i < 40000; i++) file.put(static_cast<char>('a' + i % 26));
+    file.close();
+    body_ = CacheContent::fromFile(path_, 1 << 20, 0, "text/plain");
+    ASSERT_TRUE(body_.isValid());
+  }
+
+  void TearDown() override { std::remove(path_.c_str()); }
+
+  Http2Session::Handler handler() {
+    return [this](const HttpUtils::HttpRequest& request) {
+      paths_.push_back(request.pathname);
+      Http2Session::Response result;
+      result.response.setContentType(body_.contentType()).setContentLength(body_.size());
+      result.body = body_;
+      return result;
+    };
+  }
+
+  std::string path_;
+  CacheContent body_;
+  std::vector<std::string> paths_;
+};
+}  // namespace
+
+TEST_F(Http2SessionTest, Request) {
+  Http2Session session(handler());
+  Hpack::Encoder encoder;
+  auto input = std::string(Http2Session::PREFACE, Http2Session::PREFACE_SIZE) +
+               frame(0x4, 0, 0, "") + request(encoder, 1, "/a.txt?x=1");
+  /* byte by byte, frames may be split anywhere */
+  for (char c : input) ASSERT_TRUE(session.feed(&c, 1));
+  ASSERT_EQ(paths_, std::vector<std::string>{"/a.txt"});
+
+  auto frames = output(session);
+  ASSERT_GE(frames.size(), 4);
+  EXPECT_EQ(frames[0].type, 0x4);
+  EXPECT_EQ(frames[0].flags, 0);
+  EXPECT_EQ(frames[1].type, 0x4);
+  EXPECT_EQ(frames[1].flags, 0x1);
+  EXPECT_EQ(frames[2].type, 0x1);
+  EXPECT_EQ(frames[2].streamId, 1);
+
+  Hpack::Decoder decoder;
+  Hpack::HeaderList headers;
+  ASSERT_TRUE(decoder.decode(reinterpret_cast<const uint8_t*>(frames[2].payload.data()),
+                             frames[2].payload.size(), headers));
+  EXPECT_EQ(headers[0], Hpack::Header(":status", "200"));
+  EXPECT_EQ(headers[2], Hpack::Header("content-length", "40000"));
+
+  /* 40000 bytes fit into the default window, in frames of 16384 bytes */
+  std::string body;
+  for (size_t i = 3; i < frames.size(); i++) {
+    EXPECT_EQ(frames[i].type, 0x0);
+    EXPECT_LE(frames[i].payload.size(), 16384);
+    EXPECT_EQ(frames[i].flags, i + 1 == frames.size() ? 0x1 : 0);
+    body += frames[i].payload;
+  }
+  EXPECT_EQ(body, body_.getContent());
+}
+
+TEST_F(Http2SessionTest, FlowControl) {
+  Http2Session session(handler());
+  Hpack::Encoder encoder;
+  /* SETTINGS_INITIAL_WINDOW_SIZE = 100 */
+  auto input = std::string(Http2Session::PREFACE, Http2Session::PREFACE_SIZE) +
+               frame(0x4, 0, 0, std::string("\x00\x04", 2) + u32(100)) +
+               request(encoder, 1, "/");
+  ASSERT_TRUE(session.feed(input.data(), input.size()));
+
+  auto frames = output(session);
+  ASSERT_EQ(frames.back().type, 0x0);
+  EXPECT_EQ(frames.back().payload.size(), 100);
+  EXPECT_TRUE(output(session).empty());
+
+  auto update = frame(0x8, 0, 1, u32(1000));
+  ASSERT_TRUE(session.feed(update.data(), update.size()));
+  frames = output(session);
+  ASSERT_EQ(frames.size(), 1);
+  EXPECT_EQ(frames[0].payload.size(), 1000);
+  EXPECT_EQ(frames[0].flags, 0);
+}
+
+TEST_F(Http2SessionTest, Interleave) {
+  Http2Session session(handler());
+  Hpack::Encoder encoder;
+  auto input = std::string(Http2Session::PREFACE, Http2Session::PREFACE_SIZE) +
+               frame(0x4, 0, 0, "") + frame(0x8, 0, 0, u32(1 << 20));
+  /* blocks must be encoded in order */
+  input += request(encoder, 1, "/1");
+  input += request(encoder, 3, "/3");
+  ASSERT_TRUE(session.feed(input.data(), input.size()));
+
+  std::vector<uint32_t> order;
+  for (auto& frame : output(session)) {
+    if (frame.type == 0x0) order.push_back(frame.streamId);
+  }
+  EXPECT_EQ(order, (std::vector<uint32_t>{1, 3, 1, 3, 1, 3}));
+}
+
+TEST_F(Http2SessionTest, Upgrade) {
+  Http2Session session(handler());
+  std::string head = "GET /up HTTP/1.1\r\nHost: x\r\n";
+  HttpUtils::HttpRequest request(head);
+  /* empty SETTINGS payload */
+  ASSERT_TRUE(session.upgrade(request, ""));
+  ASSERT_EQ(paths_, std::vector<std::string>{"/up"});
+
+  auto frames = output(session);
+  EXPECT_EQ(frames[0].type, 0x4);
+  EXPECT_EQ(frames[1].type, 0x1);
+  EXPECT_EQ(frames[1].streamId, 1);
+  EXPECT_FALSE(session.upgrade(request, "*"));
+}
+
+TEST_F(Http2SessionTest, ConnectionError) {
+  Http2Session session(handler());
+  std::string input = "GET / HTTP/1.1\r\nHost: x\r\n\r\n";
+  EXPECT_FALSE(session.feed(input.data(), input.size()));
+
+  auto frames = output(session);
+  ASSERT_EQ(frames.back().type, 0x7);
+  EXPECT_EQ(frames.back().payload.substr(4), u32(0x1));
+  EXPECT_TRUE(session.closed());
+}
+
+TEST_F(Http2SessionTest, ContinuationFlood) {
+  Http2Session session(handler());
+  Hpack::Encoder encoder;
+  std::string block;
+  encoder.encode({{":method", "GET"}, {":path", "/"}}, block);
+  /* HEADERS without END_HEADERS, followed by CONTINUATIONs which never end the block */
+  auto input = std::string(Http2Session::PREFACE, Http2Session::PREFACE_SIZE) +
+               frame(0x4, 0, 0, "") + frame(0x1, 0x1, 1, block);
+  ASSERT_TRUE(session.feed(input.data(), input.size()));
+  auto continuation = frame(0x9, 0, 1, std::string(16384, 'x'));
+  bool open = true;
+  for (int i = 0; i < 1000 && open; i++) {
+    open = session.feed(continuation.data(), continuation.size());
+  }
+  EXPECT_FALSE(open);
+  EXPECT_TRUE(paths_.empty());
+
+  /* GOAWAY with ENHANCE_YOUR_CALM */
+  auto frames = output(session);
+  ASSERT_EQ(frames.back().type, 0x7);
+  EXPECT_EQ(frames.back().payload.substr(4), u32(0xb));
+}
+
+TEST_F(Http2SessionTest, ControlFlood) {
+  Http2Session session(handler());
+  auto input = std::string(Http2Session::PREFACE, Http2Session::PREFACE_SIZE) +
+               frame(0x4, 0, 0, "");
+  ASSERT_TRUE(session.feed(input.data(), input.size()));
+  /* PINGs whose ACKs are never collected */
+  auto ping = frame(0x6, 0, 0, std::string(8, 'p'));
+  bool open = true;
+  for (int i = 0; i < 100000 && open; i++) open = session.feed(ping.data(), ping.size());
+  EXPECT_FALSE(open);
+
+  auto frames = output(session);
+  EXPECT_LE(frames.size(), 1030);
+  ASSERT_EQ(frames.back().type, 0x7);
+  EXPECT_EQ(frames.back().payload.substr(4), u32(0xb));
+}
@@ -0,0 +1,45 @@
+#include "include/mime_types.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+TEST(MimeTypesTest, Builtin) {
+  EXPECT_STREQ(MimeTypes::lookupBuiltin("/www/index.html"), "text/html");
+  EXPECT_STREQ(MimeTypes::lookupBuiltin("/www/app.min.js"), "text/javascript");
+  EXPECT_STREQ(MimeTypes::lookupBuiltin("/www/LOGO.PNG"), "image/png");
+  EXPECT_STREQ(MimeTypes::lookupBuiltin("font.woff2"), "font/woff2");
+}
+
+TEST(MimeTypesTest, Unknown) {
+  EXPECT_STREQ(MimeTypes::lookupBuiltin("/www/README"), MimeTypes::DEFAULT_TYPE);
+  EXPECT_STREQ(MimeTypes::lookupBuiltin("/www.d/README"), MimeTypes::DEFAULT_TYPE);
+  EXPECT_STREQ(MimeTypes::lookupBuiltin("/www/file."), MimeTypes::DEFAULT_TYPE);
+  EXPECT_STREQ(MimeTypes::lookupBuiltin("/www/file.htmlx"), MimeTypes::DEFAULT_TYPE);
+  EXPECT_STREQ(MimeTypes::lookupBuiltin("/www/file.ht"), MimeTypes::DEFAULT_TYPE);
+}
+
+TEST(MimeTypesTest, Load) {
+  std::string filename = testing::TempDir() + "mime.types";
+  {
+    std::ofstream file(filename);
+    file << "# comment\n"
+         << "text/html; charset=utf-8 html\n"
+         << "text/plain;charset=utf-8 txt\n"
+         << "application/x-custom   cst  CST2 # trailing comment\n";
+  }
+
+  MimeTypes mime;
+  EXPECT_TRUE(mime.load(filename));
+  EXPECT_STREQ(mime.lookup("/x.html"), "text/html; charset=utf-8");
+  EXPECT_STREQ(mime.lookup("/x.txt"), "text/plain;charset=utf-8");
+  /* a parameter is not an extension */
+  EXPECT_STREQ(mime.lookup("/x.charset=utf-8"), MimeTypes::DEFAULT_TYPE);
+  EXPECT_STREQ(mime.lookup("a.cst"), "application/x-custom");
+  EXPECT_STREQ(mime.lookup("a.cst2"), "application/x-custom");
+  EXPECT_STREQ(mime.lookup("a.css"), "text/css");
+  EXPECT_FALSE(mime.load(filename + ".missing"));
+  std::remove(filename.c_str());
+}
@@ -0,0 +1,57 @@
+#include "include/rate_limiter.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+TEST(RateLimiterTest, Burst) {
+  RateLimiter limiter(1, 3);
+  auto client = boost::asio::ip::make_address("10.0.0.1");
+  auto now = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(limiter.acquire(client, now), 0);
+  }
+  EXPECT_GT(limiter.acquire(client, now), 0);
+
+  /* Other clients have their own bucket */
+  EXPECT_EQ(limiter.acquire(boost::asio::ip::make_address("10.0.0.2"), now), 0);
+  EXPECT_EQ(limiter.size(), 2);
+}
+
+TEST(RateLimiterTest, Refill) {
+  RateLimiter limiter(2, 1);
+  auto client = boost::asio::ip::make_address("::1");
+  auto now = std::chrono::steady_clock::now();
+
+  EXPECT_EQ(limiter.acquire(client, now), 0);
+  EXPECT_EQ(limiter.acquire(client, now), 1);
+  EXPECT_EQ(limiter.acquire(client, now + std::chrono::milliseconds(500)), 0);
+}
+
+TEST(RateLimiterTest, MappedAddress) {
+  RateLimiter limiter(1, 1);
+  auto now = std::chrono::steady_clock::now();
+
+  /* IPv4 and IPv4-mapped IPv6 are the same client */
+  EXPECT_EQ(limiter.acquire(boost::asio::ip::make_address("127.0.0.1"), now), 0);
+  EXPECT_GT(limiter.acquire(boost::asio::ip::make_address("::ffff:127.0.0.1"), now), 0);
+}
+
+TEST(AdmissionControllerTest, Bound) {
+  AdmissionController admission(2);
+  auto first = admission.tryEnter();
+  auto second = admission.tryEnter();
+  EXPECT_TRUE(first);
+  EXPECT_TRUE(second);
+  EXPECT_FALSE(admission.tryEnter());
+  EXPECT_EQ(admission.inFlight(), 2);
+
+  first.release();
+  EXPECT_EQ(admission.inFlight(), 1);
+  {
+    auto third = admission.tryEnter();
+    EXPECT_TRUE(third);
+  }
+  EXPECT_EQ(admission.inFlight(), 1);
+}
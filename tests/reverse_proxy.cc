@@ -0,0 +1,303 @@
+#include "include/reverse_proxy.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/connection.hpp"
+
+using boost::asio::ip::tcp;
+
+namespace {
+/*
+ * Stand-in upstream, answers every request on a connection with
+ * "<method> <path> <body size>", until the client closes it.
+ * If answers is not 0, a connection answers that many requests, then reads one more
+ * and closes without answering, like a keep-alive connection timed out by the upstream.
+ */
+class Backend {
+ public:
+  explicit Backend(int answers = 0)
+      : acceptor_(io_, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)),
+        answers_(answers) {
+    thread_ = std::thread([this] {
+      while (true) {
+        tcp::socket socket(io_);
+        boost::system::error_code ec;
+        acceptor_.accept(socket, ec);
+        if (ec || stopped_) return;
+        accepted_++;
+        serve_(std::move(socket));
+      }
+    });
+  }
+
+  ~Backend() {
+    stopped_ = true;
+    tcp::socket wake(io_);
+    wake.connect(acceptor_.local_endpoint());
+    thread_.join();
+  }
+
+  tcp::endpoint endpoint() const { return acceptor_.local_endpoint(); }
+  int accepted() const { return accepted_; }
+  int received() const { return received_; }
+
+ private:
+  void serve_(tcp::socket socket) {
+    std::string input;
+    boost::system::error_code ec;
+    for (int answered = 0;; answered++) {
+      auto end =
+          boost::asio::read_until(socket, boost::asio::dynamic_buffer(input), "\r\n\r\n", ec);
+      if (ec) return;
+      auto head = input.substr(0, end);
+      input.erase(0, end);
+
+      size_t length = 0;
+      auto pos = head.find("content-length: ");
+      if (pos != std::string::npos) length = std::stoul(head.substr(pos + 16));
+      if (input.size() < length) {
+        boost::asio::read(socket, boost::asio::dynamic_buffer(input),
+                          boost::asio::transfer_exactly(length - input.size()), ec);
+      }
+      input.erase(0, length);
+      received_++;
+      if (answers_ > 0 && answered == answers_) return;
+
+      auto firstLine = head.substr(0, head.find(" HTTP/"));
+      auto body = firstLine + " " + std::to_string(length);
+      auto response = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) +
+                      "\r\nConnection: keep-alive\r\n\r\n" + body;
+      boost::asio::write(socket, boost::asio::buffer(response), ec);
+      if (ec) return;
+    }
+  }
+
+  boost::asio::io_context io_;
+  tcp::acceptor acceptor_;
+  std::thread thread_;
+  int answers_;
+  std::atomic<int> accepted_{0};
+  std::atomic<int> received_{0};
+  std::atomic<bool> stopped_{false};
+};
+
+/* Send request on a new connection, return the whole response */
+std::string fetch(const tcp::endpoint& endpoint, const std::string& request) {
+  boost::asio::io_context io;
+  tcp::socket socket(io);
+  socket.connect(endpoint);
+  boost::asio::write(socket, boost::asio::buffer(request));
+  std::string response;
+  boost::system::error_code ec;
+  auto end = boost::asio::read_until(socket, boost::asio::dynamic_buffer(response), "\r\n\r\n", ec);
+  if (ec) return response;
+  auto pos = response.find("content-length: ");
+  if (pos == std::string::npos) pos = response.find("Content-Length: ");
+  size_t length = pos == std::string::npos ? 0 : std::stoul(response.substr(pos + 16));
+  if (response.size() < end + length) {
+    boost::asio::read(socket, boost::asio::dynamic_buffer(response),
+                      boost::asio::transfer_exactly(end + length - response.size()), ec);
+  }
+  return response;
+}
+}  // namespace
+
+TEST(ReverseProxyTest, Routes) {
+  ReverseProxy::Routes routes;
+  EXPECT_TRUE(routes.empty());
+  EXPECT_TRUE(routes.add("/api=127.0.0.1:8080"));
+  EXPECT_TRUE(routes.add("/api/v2=127.0.0.1:8081"));
+  EXPECT_TRUE(routes.add("/static/=[::1]:8082"));
+  EXPECT_FALSE(routes.add("api=127.0.0.1:8080"));
+  EXPECT_FALSE(routes.add("/api=127.0.0.1"));
+
+  EXPECT_EQ(routes.match("/api")->endpoint.port(), 8080);
+  EXPECT_EQ(routes.match("/api/users")->endpoint.port(), 8080);
+  EXPECT_EQ(routes.match("/api/v2/users")->endpoint.port(), 8081);
+  EXPECT_EQ(routes.match("/static/a.css")->endpoint.port(), 8082);
+  EXPECT_EQ(routes.match("/apis"), nullptr);
+  EXPECT_EQ(routes.match("/index.html"), nullptr);
+}
+
+TEST(ReverseProxyTest, ForwardHeads) {
+  std::string out;
+  BodyFramer body;
+  std::string request =
+      "POST /api/x HTTP/1.1\r\nHost: a\r\nConnection: close, X-Secret\r\nX-Secret: 1\r\n"
+      "X-Forwarded-For: 10.0.0.1\r\nContent-Length: 5\r\n\r\n";
+  ASSERT_TRUE(ReverseProxy::forwardRequestHead(request, "127.0.0.1", out, body));
+  EXPECT_EQ(out,
+            "POST /api/x HTTP/1.1\r\nhost: a\r\ncontent-length: 5\r\n"
+            "x-forwarded-for: 10.0.0.1, 127.0.0.1\r\nconnection: keep-alive\r\n\r\n");
+  EXPECT_EQ(body.mode(), BodyFramer::Mode::LENGTH);
+
+  /* conflicting lengths, and space before colon */
+  EXPECT_FALSE(ReverseProxy::forwardRequestHead(
+      "GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n", "", out, body));
+  EXPECT_FALSE(ReverseProxy::forwardRequestHead(
+      "GET / HTTP/1.1\r\nContent-Length : 1\r\n\r\n", "", out, body));
+
+  bool keepAlive = false;
+  unsigned status = 0;
+  ASSERT_TRUE(ReverseProxy::forwardResponseHead(
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nKeep-Alive: timeout=5\r\n\r\n", "GET",
+      out, body, keepAlive, status));
+  EXPECT_EQ(out, "HTTP/1.1 200 OK\r\ntransfer-encoding: chunked\r\n\r\n");
+  EXPECT_EQ(body.mode(), BodyFramer::Mode::CHUNKED);
+  EXPECT_TRUE(keepAlive);
+  EXPECT_EQ(status, 200);
+
+  /* no length, the body ends when the upstream closes */
+  ASSERT_TRUE(
+      ReverseProxy::forwardResponseHead("HTTP/1.0 200 OK\r\n\r\n", "GET", out, body, keepAlive,
+                                        status));
+  EXPECT_EQ(out, "HTTP/1.1 200 OK\r\nconnection: close\r\n\r\n");
+  EXPECT_FALSE(keepAlive);
+
+  ASSERT_TRUE(ReverseProxy::forwardResponseHead("HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n",
+                                                "HEAD", out, body, keepAlive, status));
+  EXPECT_TRUE(body.done());
+}
+
+TEST(ReverseProxyTest, UpstreamPool) {
+  boost::asio::io_context io;
+  tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+  auto endpoint = acceptor.local_endpoint();
+  ReverseProxy::UpstreamPool pool(1);
+  EXPECT_EQ(pool.acquire(endpoint), nullptr);
+
+  auto socket = std::make_unique<tcp::socket>(io);
+  socket->connect(endpoint);
+  tcp::socket peer(io);
+  acceptor.accept(peer);
+  auto raw = socket.get();
+  pool.release(endpoint, std::move(socket));
+  EXPECT_EQ(pool.idleCount(endpoint), 1);
+  socket = pool.acquire(endpoint);
+  EXPECT_EQ(socket.get(), raw);
+
+  /* closed by the peer */
+  pool.release(endpoint, std::move(socket));
+  peer.close();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(pool.acquire(endpoint), nullptr);
+  EXPECT_EQ(pool.idleCount(endpoint), 0);
+}
+
+TEST(ReverseProxyTest, Loopback) {
+  Backend backend;
+  auto dir = testing::TempDir();
+  std::ofstream(dir + "reverse_proxy.txt") << "static";
+  boost::filesystem::current_path(dir);
+
+  boost::asio::io_context io;
+  auto routes = std::make_shared<ReverseProxy::Routes>();
+  routes->add("/api", backend.endpoint());
+  auto context = std::make_shared<ServerContext>();
+  context->routes = routes;
+  context->upstreams = std::make_shared<ReverseProxy::UpstreamPool>();
+
+  tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+  std::function<void()> accept = [&] {
+    auto conn = std::make_shared<Connection>(io, context);
+    acceptor.async_accept(conn->socket(), [&, conn](boost::system::error_code ec) {
+      if (!ec) conn->start();
+      accept();
+    });
+  };
+  accept();
+  std::thread server([&] { io.run(); });
+  auto front = acceptor.local_endpoint();
+
+  auto response = fetch(front, "GET /api/a?x=1 HTTP/1.1\r\nHost: a\r\n\r\n");
+  EXPECT_EQ(response.substr(0, 15), "HTTP/1.1 200 OK");
+  EXPECT_NE(response.find("\r\n\r\nGET /api/a?x=1 0"), std::string::npos);
+
+  /* a body larger than every buffer streams through */
+  std::string body(200000, 'b');
+  response = fetch(front, "POST /api/b HTTP/1.1\r\nHost: a\r\nContent-Length: 200000\r\n\r\n" +
+                              body);
+  EXPECT_NE(response.find("\r\n\r\nPOST /api/b 200000"), std::string::npos);
+
+  response = fetch(front, "GET /reverse_proxy.txt HTTP/1.1\r\nHost: a\r\n\r\n");
+  EXPECT_NE(response.find("\r\n\r\nstatic"), std::string::npos);
+
+  /* every client connection reused the same upstream connection */
+  EXPECT_EQ(backend.accepted(), 1);
+
+  io.stop();
+  server.join();
+  std::remove((dir + "reverse_proxy.txt").c_str());
+}
+
+TEST(ReverseProxyTest, StalePooledConnection) {
+  Backend backend(1);
+  boost::asio::io_context io;
+  auto routes = std::make_shared<ReverseProxy::Routes>();
+  routes->add("/api", backend.endpoint());
+  auto context = std::make_shared<ServerContext>();
+  context->routes = routes;
+  context->upstreams = std::make_shared<ReverseProxy::UpstreamPool>();
+
+  tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+  std::function<void()> accept = [&] {
+    auto conn = std::make_shared<Connection>(io, context);
+    acceptor.async_accept(conn->socket(), [&, conn](boost::system::error_code ec) {
+      if (!ec) conn->start();
+      accept();
+    });
+  };
+  accept();
+  std::thread server([&] { io.run(); });
+  auto front = acceptor.local_endpoint();
+
+  /* wait until the upstream connection of the last exchange is parked, the pool is per thread */
+  auto idle = [&] {
+    std::promise<size_t> count;
+    boost::asio::post(
+        io, [&] { count.set_value(context->upstreams->idleCount(backend.endpoint())); });
+    return count.get_future().get();
+  };
+  auto parked = [&] {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (idle() == 0) {
+      if (std::chrono::steady_clock::now() > deadline) return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+  };
+
+  auto response = fetch(front, "GET /api/a HTTP/1.1\r\nHost: a\r\n\r\n");
+  EXPECT_EQ(response.substr(0, 15), "HTTP/1.1 200 OK");
+  ASSERT_TRUE(parked());
+
+  /* the pooled connection drops the POST, which may have been acted on, it's not sent again */
+  response = fetch(front, "POST /api/b HTTP/1.1\r\nHost: a\r\nContent-Length: 1\r\n\r\nx");
+  EXPECT_EQ(response.substr(0, 12), "HTTP/1.1 502");
+  EXPECT_EQ(backend.received(), 2);
+  EXPECT_EQ(backend.accepted(), 1);
+
+  /* a GET is replayed on a new connection */
+  response = fetch(front, "GET /api/c HTTP/1.1\r\nHost: a\r\n\r\n");
+  EXPECT_EQ(response.substr(0, 15), "HTTP/1.1 200 OK");
+  ASSERT_TRUE(parked());
+  response = fetch(front, "GET /api/d HTTP/1.1\r\nHost: a\r\n\r\n");
+  EXPECT_EQ(response.substr(0, 15), "HTTP/1.1 200 OK");
+  EXPECT_NE(response.find("\r\n\r\nGET /api/d 0"), std::string::npos);
+  EXPECT_EQ(backend.received(), 5);
+  EXPECT_EQ(backend.accepted(), 3);
+
+  io.stop();
+  server.join();
+}
@@ -2,10 +2,26 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <future>
 #include <mutex>
 #include <thread>
+#include <vector>
+
+namespace {
+/* Poll condition until it holds or a deadline generous enough for a loaded machine */
+template <typename Condition>
+bool eventually(Condition condition) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return true;
+}
+}  // namespace
 
 TEST(ThreadPoolTest, Basic) {
   ThreadPool tp(5);
@@ -98,3 +114,152 @@ TEST(ThreadPoolTest, Scheduler) {
 
   tp.abort();
 }
+
+TEST(ThreadPoolTest, Stats) {
+  ThreadPool tp(2);
+  auto result = tp.dispatch([] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    return 1;
+  });
+  EXPECT_EQ(result.get(), 1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  auto stats = tp.stats();
+  EXPECT_EQ(stats.completed, 1);
+  EXPECT_GE(stats.totalRun, std::chrono::milliseconds(20));
+  EXPECT_EQ(stats.maxRun, stats.totalRun);
+  EXPECT_LT(stats.maxWait, std::chrono::milliseconds(20));
+  EXPECT_EQ(stats.grown, 0);
+  tp.abort();
+}
+
+TEST(ThreadPoolTest, Elastic) {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool release = false;
+
+  ThreadPool::Elastic options;
+  options.minWorkers = 1;
+  options.maxWorkers = 4;
+  options.targetWait = std::chrono::milliseconds(5);
+  options.idleGrace = std::chrono::milliseconds(100);
+  ThreadPool tp(options);
+  EXPECT_EQ(tp.workerSize(), 1);
+  EXPECT_EQ(tp.avaliableWorkerSize(), 1);
+
+  /* A burst of blocking jobs, the queue waits too long and the pool grows up to the bound */
+  std::vector<std::future<void>> results;
+  for (int i = 0; i < 6; ++i) {
+    results.push_back(tp.dispatch([&] {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&] { return release; });
+    }));
+  }
+  EXPECT_TRUE(eventually([&] { return tp.workerSize() == 4 && tp.remainJobSize() == 2; }));
+  EXPECT_TRUE(eventually([&] { return tp.avaliableWorkerSize() == 0; }));
+  EXPECT_EQ(tp.workerSize(), 4);
+  EXPECT_EQ(tp.remainJobSize(), 2);
+  EXPECT_EQ(tp.stats().grown, 3);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    release = true;
+  }
+  cv.notify_all();
+  for (auto& result : results) result.get();
+  /* the stats of a job are counted just after its future is ready */
+  EXPECT_TRUE(eventually([&] { return tp.stats().completed == 6; }));
+  EXPECT_GE(tp.stats().maxWait, std::chrono::milliseconds(5));
+
+  /* Idle workers retire after the grace period, down to the lower bound */
+  EXPECT_TRUE(eventually([&] { return tp.workerSize() == 1; }));
+  EXPECT_TRUE(eventually([&] { return tp.avaliableWorkerSize() == 1; }));
+  EXPECT_EQ(tp.stats().retired, 3);
+
+  /* The remaining worker still serves jobs */
+  EXPECT_EQ(tp.dispatch([] { return 7; }).get(), 7);
+  tp.abort();
+}
+
+TEST(ThreadPoolTest, WeightedPriorities) {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool release = false;
+  std::vector<ThreadPool::Priority> order;
+  ThreadPool tp(1);
+
+  /* Fill up workers */
+  tp.dispatch([&] {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return release; });
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  std::vector<std::future<void>> results;
+  for (auto priority :
+       {ThreadPool::Priority::LOW, ThreadPool::Priority::NORMAL, ThreadPool::Priority::HIGH}) {
+    for (int i = 0; i < 8; ++i) {
+      results.push_back(tp.submit(priority, [&, priority] { order.push_back(priority); }));
+    }
+  }
+  EXPECT_EQ(tp.remainJobSize(), 24);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    release = true;
+  }
+  cv.notify_all();
+  for (auto& result : results) result.get();
+
+  /* While every class has jobs, they share the worker 4:2:1 and LOW is not starved */
+  ASSERT_EQ(order.size(), 24);
+  int counts[3] = {};
+  for (int i = 0; i < 7; ++i) counts[static_cast<int>(order[i])]++;
+  EXPECT_EQ(counts[0], 4);
+  EXPECT_EQ(counts[1], 2);
+  EXPECT_EQ(counts[2], 1);
+  EXPECT_EQ(order.back(), ThreadPool::Priority::LOW);
+  tp.abort();
+}
+
+TEST(ThreadPoolTest, DeadlineAndCancel) {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool release = false;
+  std::atomic<int> ran{0};
+  ThreadPool tp(1);
+
+  tp.dispatch([&] {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return release; });
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  auto now = ThreadPool::Clock::now();
+  auto expired = tp.submit({ThreadPool::Priority::HIGH, now + std::chrono::milliseconds(5)},
+                           [&] { return ++ran; });
+  auto token = ThreadPool::CancelToken::create();
+  auto cancelled = tp.submit({ThreadPool::Priority::NORMAL, ThreadPool::Clock::time_point::max(),
+                              token},
+                             [&] { return ++ran; });
+  auto kept = tp.submit({ThreadPool::Priority::LOW, now + std::chrono::seconds(10)},
+                        [&] { return ++ran; });
+  token.cancel();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    release = true;
+  }
+  cv.notify_all();
+
+  EXPECT_THROW(expired.get(), ThreadPool::Expired);
+  EXPECT_THROW(cancelled.get(), ThreadPool::Cancelled);
+  EXPECT_EQ(kept.get(), 1);
+  EXPECT_EQ(ran.load(), 1);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  auto stats = tp.stats();
+  EXPECT_EQ(stats.expired, 1);
+  EXPECT_EQ(stats.cancelled, 1);
+  EXPECT_EQ(stats.completed, 2);
+  tp.abort();
+}
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "include/connection.hpp"
+#include "include/tls_context.hpp"
+
+namespace {
+/* Write a self-signed certificate and its key for localhost */
+void writeSelfSigned(const std::string& certFile, const std::string& keyFile) {
+  EVP_PKEY* key = EVP_EC_gen("P-256");
+  X509* cert = X509_new();
+  X509_set_version(cert, 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+  X509_set_pubkey(cert, key);
+  auto name = X509_get_subject_name(cert);
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                             reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+  X509_set_issuer_name(cert, name);
+  X509_sign(cert, key, EVP_sha256());
+
+  auto fp = fopen(keyFile.c_str(), "w");
+  PEM_write_PrivateKey(fp, key, nullptr, nullptr, 0, nullptr, nullptr);
+  fclose(fp);
+  fp = fopen(certFile.c_str(), "w");
+  PEM_write_X509(fp, cert);
+  fclose(fp);
+  X509_free(cert);
+  EVP_PKEY_free(key);
+}
+}  // namespace
+
+TEST(TlsTest, LoopbackResume) {
+  namespace ssl = boost::asio::ssl;
+  using boost::asio::ip::tcp;
+  auto dir = testing::TempDir();
+  writeSelfSigned(dir + "tls_test.crt", dir + "tls_test.key");
+  std::ofstream(dir + "tls_test.txt") << "hello tls";
+  boost::filesystem::current_path(dir);
+
+  auto context = std::make_shared<ServerContext>();
+  context->tls = TlsContext::makeServerContext(dir + "tls_test.crt", dir + "tls_test.key");
+
+  boost::asio::io_context io;
+  tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+  std::function<void()> accept = [&] {
+    auto conn = std::make_shared<Connection>(io, context);
+    acceptor.async_accept(conn->socket(), [&, conn](boost::system::error_code ec) {
+      if (!ec) conn->start();
+      accept();
+    });
+  };
+  accept();
+  std::thread server([&] { io.run(); });
+
+  ssl::context clientContext(ssl::context::tls_client);
+  clientContext.set_verify_mode(ssl::verify_none);
+  SSL_CTX_set_session_cache_mode(clientContext.native_handle(), SSL_SESS_CACHE_CLIENT);
+
+  /* Fetch the file, resume with session if it isn't null, return the session for next fetch */
+  auto fetch = [&](SSL_SESSION* session, bool& reused) -> SSL_SESSION* {
+    boost::asio::io_context clientIo;
+    ssl::stream<tcp::socket> stream(clientIo, clientContext);
+    stream.next_layer().connect(acceptor.local_endpoint());
+    if (session) SSL_set_session(stream.native_handle(), session);
+    stream.handshake(ssl::stream_base::client);
+    reused = SSL_session_reused(stream.native_handle());
+
+    std::string request = "GET /tls_test.txt HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    boost::asio::write(stream, boost::asio::buffer(request));
+    std::string response;
+    boost::asio::read_until(stream, boost::asio::dynamic_buffer(response), "hello tls");
+    EXPECT_EQ(response.substr(0, 15), "HTTP/1.1 200 OK");
+    auto result = SSL_get1_session(stream.native_handle());
+    boost::system::error_code ignored;
+    stream.shutdown(ignored);
+    return result;
+  };
+
+  bool reused = false;
+  auto session = fetch(nullptr, reused);
+  EXPECT_FALSE(reused);
+  ASSERT_NE(session, nullptr);
+  auto next = fetch(session, reused);
+  EXPECT_TRUE(reused);
+  SSL_SESSION_free(session);
+  SSL_SESSION_free(next);
+
+  /* a client which never answers close_notify is closed after a deadline */
+  boost::asio::io_context clientIo;
+  ssl::stream<tcp::socket> stream(clientIo, clientContext);
+  stream.next_layer().connect(acceptor.local_endpoint());
+  stream.handshake(ssl::stream_base::client);
+  /* uploads are disabled, the answer closes the connection */
+  boost::asio::write(stream, boost::asio::buffer(std::string(
+                                 "POST /tls_test.txt HTTP/1.1\r\nHost: localhost\r\n"
+                                 "Content-Length: 1\r\n\r\nx")));
+  std::string response;
+  boost::asio::read_until(stream, boost::asio::dynamic_buffer(response), "\r\n\r\n");
+  EXPECT_EQ(response.substr(0, 12), "HTTP/1.1 405");
+  bool closed = false;
+  char raw[256];
+  std::function<void()> drain = [&] {
+    /* the raw bytes, so close_notify is read but not answered */
+    stream.next_layer().async_read_some(boost::asio::buffer(raw),
+                                        [&](boost::system::error_code ec, std::size_t) {
+                                          if (ec) {
+                                            closed = true;
+                                          } else {
+                                            drain();
+                                          }
+                                        });
+  };
+  drain();
+  clientIo.run_for(std::chrono::seconds(10));
+  EXPECT_TRUE(closed);
+
+  io.stop();
+  server.join();
+  std::remove((dir + "tls_test.crt").c_str());
+  std::remove((dir + "tls_test.key").c_str());
+  std::remove((dir + "tls_test.txt").c_str());
+}
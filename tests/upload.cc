@@ -0,0 +1,172 @@
+#include "include/upload.hpp"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "include/connection.hpp"
+
+namespace {
+std::string readFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+/*
+ * Empty directory of the running test, ctest runs every test in its own process in parallel,
+ * so the temp files of one test are not counted by another.
+ */
+std::string testDir() {
+  auto dir = testing::TempDir() + "upload_" +
+             testing::UnitTest::GetInstance()->current_test_info()->name() + "_" +
+             std::to_string(getpid()) + "/";
+  boost::filesystem::remove_all(dir);
+  boost::filesystem::create_directories(dir);
+  return dir;
+}
+
+/* Number of temp files left in directory */
+int tempFiles(const std::string& directory) {
+  int count = 0;
+  for (auto& entry : boost::filesystem::directory_iterator(directory)) {
+    if (entry.path().filename().string().compare(0, 8, ".upload-") == 0) count++;
+  }
+  return count;
+}
+}  // namespace
+
+TEST(UploadTest, WriteAndCommit) {
+  auto dir = testDir();
+  auto target = dir + "upload_test.bin";
+  std::string content;
+  for (int i = 0; i < 300000; i++) content.push_back(static_cast<char>(i * 7));
+
+  auto temps = tempFiles(dir);
+  auto upload = Upload::create(target, true, content.size());
+  ASSERT_NE(upload, nullptr);
+  /* sizes which are not aligned */
+  ASSERT_TRUE(upload->write(content.data(), 1000));
+  ASSERT_TRUE(upload->write(content.data() + 1000, 270000));
+  ASSERT_TRUE(upload->write(content.data() + 271000, content.size() - 271000));
+  EXPECT_EQ(upload->size(), content.size());
+  EXPECT_FALSE(boost::filesystem::exists(target));
+  ASSERT_TRUE(upload->commit());
+  upload.reset();
+  EXPECT_EQ(readFile(target), content);
+  EXPECT_EQ(tempFiles(dir), temps);
+
+  /* not committed, the target is untouched */
+  upload = Upload::create(target, false, 0);
+  ASSERT_TRUE(upload->write("abc", 3));
+  EXPECT_EQ(tempFiles(dir), temps + 1);
+  upload.reset();
+  EXPECT_EQ(tempFiles(dir), temps);
+  EXPECT_EQ(readFile(target), content);
+  std::remove(target.c_str());
+
+  EXPECT_EQ(Upload::create(dir + "missing/upload_test.bin", false, 0), nullptr);
+  boost::filesystem::remove_all(dir);
+}
+
+TEST(UploadTest, Splice) {
+  auto dir = testDir();
+  auto target = dir + "upload_splice.bin";
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  std::string content(50000, 's');
+  std::thread writer([&] {
+    auto written = write(fds[1], content.data(), content.size());
+    EXPECT_EQ(written, static_cast<ssize_t>(content.size()));
+    close(fds[1]);
+  });
+
+  auto upload = Upload::create(target, false, content.size());
+  ASSERT_NE(upload, nullptr);
+  ASSERT_TRUE(upload->write("head", 4));
+  ssize_t moved;
+  while ((moved = upload->spliceFrom(fds[0], 1 << 20)) != 0) {
+    if (moved < 0) {
+      ASSERT_EQ(errno, EAGAIN);
+    }
+  }
+  writer.join();
+  close(fds[0]);
+  EXPECT_EQ(upload->size(), content.size() + 4);
+  ASSERT_TRUE(upload->commit());
+  EXPECT_EQ(readFile(target), "head" + content);
+  boost::filesystem::remove_all(dir);
+}
+
+TEST(UploadTest, Loopback) {
+  using boost::asio::ip::tcp;
+  auto dir = testDir();
+  boost::filesystem::current_path(dir);
+  auto temps = tempFiles(dir);
+
+  auto context = std::make_shared<ServerContext>();
+  context->maxUploadSize = 1 << 20;
+  boost::asio::io_context io;
+  tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+  std::function<void()> accept = [&] {
+    auto conn = std::make_shared<Connection>(io, context);
+    acceptor.async_accept(conn->socket(), [&, conn](boost::system::error_code ec) {
+      if (!ec) conn->start();
+      accept();
+    });
+  };
+  accept();
+  std::thread server([&] { io.run(); });
+
+  boost::asio::io_context clientIo;
+  tcp::socket socket(clientIo);
+  socket.connect(acceptor.local_endpoint());
+  std::string response;
+
+  /* the body is only sent after 100 Continue */
+  std::string body(100000, 'u');
+  boost::asio::write(socket, boost::asio::buffer(std::string(
+                                 "PUT /upload_loopback.bin HTTP/1.1\r\nHost: a\r\n"
+                                 "Content-Length: 100000\r\nExpect: 100-continue\r\n\r\n")));
+  auto end = boost::asio::read_until(socket, boost::asio::dynamic_buffer(response), "\r\n\r\n");
+  EXPECT_EQ(response.substr(0, end), "HTTP/1.1 100 Continue\r\n\r\n");
+  response.erase(0, end);
+  boost::asio::write(socket, boost::asio::buffer(body));
+  end = boost::asio::read_until(socket, boost::asio::dynamic_buffer(response), "\r\n\r\n");
+  EXPECT_EQ(response.substr(0, 20), "HTTP/1.1 201 Created");
+  response.erase(0, end);
+  EXPECT_EQ(readFile(dir + "upload_loopback.bin"), body);
+
+  /* chunked on the same connection, replaces the file */
+  boost::asio::write(socket, boost::asio::buffer(std::string(
+                                 "PUT /upload_loopback.bin HTTP/1.1\r\nHost: a\r\n"
+                                 "Transfer-Encoding: chunked\r\n\r\n3\r\nnew\r\n0\r\n\r\n")));
+  boost::asio::read_until(socket, boost::asio::dynamic_buffer(response), "\r\n\r\n");
+  EXPECT_EQ(response.substr(0, 15), "HTTP/1.1 200 OK");
+  EXPECT_EQ(readFile(dir + "upload_loopback.bin"), "new");
+
+  /* over the limit */
+  tcp::socket large(clientIo);
+  large.connect(acceptor.local_endpoint());
+  boost::asio::write(large, boost::asio::buffer(std::string(
+                                "PUT /upload_large.bin HTTP/1.1\r\nHost: a\r\n"
+                                "Content-Length: 2000000\r\n\r\n")));
+  response.clear();
+  boost::asio::read_until(large, boost::asio::dynamic_buffer(response), "\r\n\r\n");
+  EXPECT_EQ(response.substr(0, 12), "HTTP/1.1 413");
+
+  io.stop();
+  server.join();
+  EXPECT_EQ(tempFiles(dir), temps);
+  boost::filesystem::current_path(testing::TempDir());
+  boost::filesystem::remove_all(dir);
+}